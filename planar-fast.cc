@@ -4,7 +4,9 @@
  *  - Use sparse nauty: DONE
  *  - use BFS?  And, whenever we go up by a number of faces, we can throw out the canonical graphs
  *    (because they'll all be too small to match). Fewer to search --> faster.
- *  - use a cubic planar canonical labeler?
+ *    DONE as --bfs, level by level on the fewest faces a state can close with.
+ *  - use a cubic planar canonical labeler? Mostly DONE: SolutionStore compares
+ *    planar codes, and only falls back to nauty for graphs with a 2-edge cut.
  * Timings for MAX_FACES=34:
  *   densenauty,            -O2 -march=native : 4m56s
  *     w/ twopaths,         -O2 -march=native : 1m32s
@@ -15,11 +17,31 @@
  *       w/ schreier,       -O2 -march=native : 1m34s
  *     w/distances_sg 3,    -O2 -march=native : 1m31s
  *       w/ schreier,       -O2 -march=native : 1m30s
+ *   With --nauty these are now tried per vertex count, and the fastest kept
+ *   (see SolutionStore::canonform.)
  */
 #include <vector>
 #include <deque>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <tuple>
+#include <array>
 #include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <cstdint>
+#include <chrono>
+#include <random>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <csignal>
+#include <cerrno>
+#include <cmath>
 #include "nausparse.h"
 
 #ifndef MAX_FACES
@@ -27,7 +49,8 @@
 #endif
 /* Without a hard max, this version fails to detect looping and never gets anywhere.
  * On the other hand, versions with looping detection fail when given MAX_FACES
- * since the previously seen states were not fully explored. */
+ * since the previously seen states were not fully explored.
+ * (--deepen gets round this by raising the max one face at a time.) */
 
 #define N_TRI  1
 #define N_SQ   2
@@ -93,6 +116,7 @@ struct GraphState {
     static sparsegraph sg;
     static sparsegraph canong;
     static int *lab, *ptn, *orbits;
+    static int nautyn;  // room in lab, ptn and orbits
     static optionblk options;
     static statsblk stats;
 
@@ -114,9 +138,8 @@ struct GraphState {
       medgadd{0}, chosenFace{0} {
         int maxn = 2 * MAX_FACES; // allows for 'overslop' of 2 faces
         int maxm = (maxn+WORDSIZE-1)/WORDSIZE;
-        lab = new int[maxn];
-        ptn = new int[maxn];
-        orbits = new int[maxn];
+        if (!lab)
+            nautyspace(maxn);
 
         options.getcanon = TRUE;
         options.invarproc = distances_sg;
@@ -252,6 +275,19 @@ struct GraphState {
         return false;
     }
 
+    /* The only valid method on the chosen face; 0 if there is none, -1 if
+     * there's a choice */
+    int forcedMethod() const {
+        int only = 0;
+        for (int m = 1; m <= NUM_METH; ++m)
+            if (isValid(chosenFace, m)) {
+                if (only)
+                    return -1;
+                only = m;
+            }
+        return only;
+    }
+
     void addEdges(int oF, int meth) {
         // oF: index to openfaces
         const int n = openfaces.size();
@@ -506,14 +542,122 @@ struct GraphState {
         addEdges(chosenFace, medgadd);
     }
 
+    /* Which open face to close next. It has to be one of the longest: the
+     * methods are only known to cover every way of closing those (closing a
+     * shorter one can need shapes they don't have, and graphs go missing).
+     * The rules choose among them, and break ties by the first in
+     * openfaces; each depends only on the boundary, like everything else
+     * in the search. */
+    enum { FACE_LONGEST, FACE_FEWEST, FACE_SQUEEZED, NUM_FACE_RULES };
+    static int facerule;
+
     void chooseFace() {
-        chosenFace = 0;
-        for (uint i = 1; i < openfaces.size(); ++i)
-            if (faces[openfaces[i]].size() > faces[openfaces[chosenFace]].size())
+        const int n = openfaces.size();
+        uint longest = 0;
+        for (int o : openfaces)
+            longest = std::max(longest, (uint)faces[o].size());
+        int best = 0;
+        chosenFace = -1;
+        for (int i = 0; i < n; ++i) {
+            if (faces[openfaces[i]].size() < longest)
+                continue;
+            int score = 0;
+            switch (facerule) {
+                case FACE_FEWEST:  // fail first: the fewest valid methods
+                    for (int m = 1; m <= NUM_METH; ++m)
+                        score += isValid(i, m);
+                    break;
+                case FACE_SQUEEZED:  // the shortest neighbours
+                    score = faces[openfaces[(i + n - 1) % n]].size()
+                            + faces[openfaces[(i + 1) % n]].size();
+                    break;
+            }
+            if (chosenFace < 0 || score < best) {
                 chosenFace = i;
+                best = score;
+            }
+        }
         medgadd = 0;
     }
 
+    /* The patch is a disk, so by Euler's formula the faces outside it (the
+     * open ones, once closed, and any still to come) carry curvature
+     * 6 + 2n - L in all, for n open faces of total length L; curvature is
+     * the sum of 6 - size. That is always exactly what the remaining
+     * squares and pentagons supply, so the budget alone rules nothing out;
+     * the shape of the boundary does:
+     *  - An open face of length 5 can only become a hexagon, by one edge
+     *    joining its ends, which makes one face of its two neighbours. With
+     *    n > 3 that face still has to get from one neighbour's far end to the
+     *    other's, so their lengths total at most 4; with n == 3 it would
+     *    surround the vertex where they meet, which has degree 2.
+     *  - With no squares or pentagons left, the outside is all hexagons and
+     *    develops flat onto the hexagonal lattice, so the boundary must close
+     *    up there: walking it, turn 60 degrees one way inside an open face's
+     *    path and the other way where two open faces meet. */
+    bool curvaturecheck() const {
+        const int n = openfaces.size();
+        for (int i = 0; i < n; ++i) {
+            if (faces[openfaces[i]].size() < 5)
+                continue;
+            if (n == 3)
+                return false;
+            if (n > 3 && faces[openfaces[(i + n - 1) % n]].size()
+                         + faces[openfaces[(i + 1) % n]].size() > 4)
+                return false;
+        }
+        return nsq < N_SQ || npent < N_PENT || flatcells() >= 0;
+    }
+
+    /* Walk the boundary on the hexagonal lattice, as above. If it closes up,
+     * return the number of cells it encloses (counted by winding number, so
+     * exactly the number of hexagons in an all-hexagon outside, including
+     * the open faces); otherwise -1. */
+    int flatcells() const {
+        static const int step[6][2] = { {1,0}, {0,1}, {-1,1}, {-1,0}, {0,-1}, {1,-1} };
+        int x = 0, y = 0, dir = 0, area = 0;
+        for (int o : openfaces) {
+            const int len = faces[o].size();
+            for (int i = 0; i < len; ++i) {
+                const int nx = x + step[dir][0], ny = y + step[dir][1];
+                area += x * ny - nx * y;  // shoelace, in lattice units
+                x = nx;
+                y = ny;
+                dir = (dir + (i < len - 1 ? 1 : 5)) % 6;
+            }
+        }
+        if (x || y || area <= 0 || area % 6)
+            return -1;
+        return area / 6;
+    }
+
+    /* A lower bound on how many faces any closure adds to faces.size() (it
+     * can be negative, as open faces may merge.) With only hexagons left it
+     * is exact, from flatcells(). Otherwise: an open face of length 4 or 5
+     * can't share its final face with another open face (that would need
+     * at least 7 edges) and can't become a square; shorter ones can share, but
+     * each final face holds at most 6 edges of their paths plus one edge
+     * between each; and the squares and pentagons still to come need faces
+     * of their own, bar pentagons on open faces of length 4. */
+    int morefaces() const {
+        const int n = openfaces.size();
+        if (nsq == N_SQ && npent == N_PENT)
+            return flatcells() - n;
+        int big = 0, len4 = 0, smallsum = 0;
+        for (int o : openfaces) {
+            const int len = faces[o].size();
+            if (len >= 4) {
+                ++big;
+                len4 += len == 4;
+            } else {
+                smallsum += len + 1;
+            }
+        }
+        const int pentleft = N_PENT - npent;
+        const int smallfaces = N_SQ - nsq + pentleft - std::min(pentleft, len4);
+        return big + std::max((smallsum + 5) / 6, smallfaces) - n;
+    }
+
     bool sizecheck() const {
         int facesoflen [7] = {};
         for (auto& F : faces) {
@@ -547,6 +691,23 @@ struct GraphState {
     }
 
     void canongraph() const {
+        canongraph(numverts, edges);
+    }
+
+    /* --deepen has no ceiling on the graph size, so this can grow */
+    static void nautyspace(int n) {
+        delete[] lab;
+        delete[] ptn;
+        delete[] orbits;
+        lab = new int[n];
+        ptn = new int[n];
+        orbits = new int[n];
+        nautyn = n;
+    }
+
+    static void canongraph(int numverts, const vector<edge>& edges) {
+        if (numverts > nautyn)
+            nautyspace(2 * numverts);
         SG_ALLOC(sg, numverts, 3*numverts, "oops");
 
         sg.nv = numverts;
@@ -576,61 +737,2977 @@ struct GraphState {
 SG_DECL(GraphState::sg);
 SG_DECL(GraphState::canong);
 int *GraphState::lab, *GraphState::ptn, *GraphState::orbits;
+int GraphState::nautyn;
+int GraphState::facerule = GraphState::FACE_LONGEST;
+const char *faceRules[] = { "longest", "fewest", "squeezed" };
 DEFAULTOPTIONS_SPARSEGRAPH(GraphState::options);
 statsblk GraphState::stats;
 
-int main() {
-    deque<GraphState> graphStack;
-    std::set<vector<int>> canonslns;
-    /* nauty canonical forms of solutions. */
-    vector<int> nsuccess(MAX_FACES - 6); // allow for 'overslop' of 1 face
-    GraphState G{};
-    
-    bool pop = false;
-    for(;;) {
-        if (pop) {
-            if (graphStack.empty())
-                break;
-            G = graphStack.back();
-            graphStack.pop_back();
-            pop = false;
+/* The largest graphs wanted: --hex-max lowers it from MAX_FACES.
+ * (A graph has 8 + nhex faces, and nhex = numverts/2 - 6.) */
+int maxFaces = MAX_FACES;
+
+/* --symmetric: only graphs with a mirror symmetry */
+bool symmetric = false;
+bool mirrored(const GraphState& G);
+
+/* Branches which can't close up within maxFaces faces.
+ * depth is the number of steps taken, each of which closes at least one face;
+ * morefaces() is usually sharper, but cheap as the depth test is, keep it.
+ * Returns why (an index to pruneReasons), or 0 to carry on. */
+const char *pruneReasons[] = { "", "depth", "single open face", "face sizes",
+                               "curvature", "faces needed", "no mirror" };
+#define NUM_PRUNE 7
+
+int prune(const GraphState& G, size_t depth) {
+    if (depth > (size_t)maxFaces - 4)
+        return 1;
+    if (G.openfaces.size() == 1)
+        return 2;
+    if (!G.sizecheck())
+        return 3;
+    if (!G.curvaturecheck())
+        return 4;
+    if ((int)G.faces.size() + G.morefaces() > maxFaces)
+        return 5;
+    if (symmetric && !mirrored(G))
+        return 6;
+    return 0;
+}
+
+/* States whose search found nothing. What can follow a state depends only on
+ * its boundary: the lengths of the open faces, in openfaces order, with the
+ * number of squares and pentagons and of faces so far.
+ * Depth only adds cuts, so a state no shallower than a dead one with the same
+ * boundary is dead too. Keys are kept whole, so a hit is never wrong; the
+ * table is a fixed array of slots indexed by hash, and a new dead end
+ * replaces whatever was in its slot. Boundaries too long for a key are
+ * never stored. */
+struct DeadEnds {
+    struct Key {
+        /* w[0]: nsq, npent (6 bits each), faces (8), 12 bits unused, then
+         * depth (8, not part of the key) and 8 lengths of 3 bits;
+         * w[1..3]: 21 lengths each. A zero length ends the list. */
+        uint64_t w[4];
+        bool operator==(const Key& o) const {
+            return ((w[0] ^ o.w[0]) & ~depthmask) == 0 && w[1] == o.w[1]
+                    && w[2] == o.w[2] && w[3] == o.w[3];
+        }
+        size_t depth() const { return (w[0] & depthmask) >> 32; }
+    };
+    static constexpr uint64_t depthmask = 0xffull << 32;
+    vector<Key> slots;  // w[0] == 0: empty
+    int maxf = -1, minf = -1;  // the face limits the entries hold for
+    unsigned long nlookups = 0, nhits = 0, nstored = 0, nreplaced = 0;
+
+    explicit DeadEnds(size_t n) : slots(n, Key{}) {}
+
+    /* Forget everything if the limits have changed */
+    void limits(int maxfaces, int minfaces) {
+        if (maxfaces != maxf || minfaces != minf)
+            std::fill(slots.begin(), slots.end(), Key{});
+        maxf = maxfaces;
+        minf = minfaces;
+    }
+
+    static bool key(const GraphState& G, size_t depth, Key& k) {
+        const int n = G.openfaces.size();
+        if (n > 71 || G.faces.size() > 255 || depth > 255 || G.nsq > 63 || G.npent > 63)
+            return false;
+        k.w[0] = (uint64_t)G.nsq | G.npent << 6 | G.faces.size() << 12 | (uint64_t)depth << 32;
+        k.w[1] = k.w[2] = k.w[3] = 0;
+        for (int i = 0; i < n; ++i) {
+            const int at = i < 8 ? 40 + 3*i : 3*((i - 8) % 21);
+            k.w[i < 8 ? 0 : 1 + (i - 8) / 21] |= (uint64_t)G.faces[G.openfaces[i]].size() << at;
         }
-        if (!G.incMethod()) {
-            pop = true;
-            continue;
+        return true;
+    }
+
+    struct Hash {
+        size_t operator()(const Key& k) const {
+            uint64_t h = k.w[0] & ~depthmask;
+            for (int i = 1; i < 4; ++i)
+                h = (h ^ h >> 31 ^ k.w[i]) * 0x9e3779b97f4a7c15ull;
+            h = (h ^ h >> 30) * 0xbf58476d1ce4e5b9ull;
+            return h ^ h >> 31;
         }
-        graphStack.push_back(G);
-        G.addEdges();
+    };
+
+    Key *slot(const Key& k) {
+        return &slots[Hash()(k) % slots.size()];
+    }
+
+    bool dead(const GraphState& G, size_t depth) {
+        Key k;
+        if (!key(G, depth, k))
+            return false;
+        ++nlookups;
+        const Key *s = slot(k);
+        if (s->w[0] && *s == k && s->depth() <= depth) {
+            ++nhits;
+            return true;
+        }
+        return false;
+    }
+
+    void add(const GraphState& G, size_t depth) {
+        Key k;
+        if (key(G, depth, k))
+            add(k);
+    }
+
+    void add(const Key& k) {
+        Key *s = slot(k);
+        if (s->w[0] && *s == k) {
+            if (s->depth() > k.depth())
+                *s = k;
+            return;
+        }
+        nreplaced += s->w[0] != 0;
+        ++nstored;
+        *s = k;
+    }
+};
+
+/* A closed GraphState as an embedded graph: the neighbours of each vertex
+ * and the two faces on each edge. */
+struct Embedding {
+    const GraphState& G;
+    vector<vector<std::pair<int,int>>> adj; // per vertex: (neighbour, edge)
+    vector<std::pair<int,int>> edgefaces;
+
+    explicit Embedding(const GraphState& g) : G(g), adj(g.numverts + 1),
+                                              edgefaces(g.edges.size(), {-1,-1}) {
+        for (uint i = 0; i < G.edges.size(); ++i) {
+            adj[G.edges[i].v1].emplace_back(G.edges[i].v2, i);
+            adj[G.edges[i].v2].emplace_back(G.edges[i].v1, i);
+        }
+        for (uint f = 0; f < G.faces.size(); ++f)
+            for (int e : G.faces[f]) {
+                if (edgefaces[e].first < 0) edgefaces[e].first = f;
+                else edgefaces[e].second = f;
+            }
+    }
+
+    int edgeid(int u, int v) const {
+        for (auto& a : adj[u])
+            if (a.first == v) return a.second;
+        return -1;
+    }
+
+    bool onface(int e, int f) const {
+        return edgefaces[e].first == f || edgefaces[e].second == f;
+    }
+
+    int otherface(int e, int f) const {
+        return edgefaces[e].first == f ? edgefaces[e].second : edgefaces[e].first;
+    }
+
+    /* Vertices of face f, starting u, v, ... */
+    vector<int> cycle(int f, int u, int v) const {
+        vector<int> cyc{u};
+        int prev = u, cur = v;
+        while (cur != u) {
+            cyc.push_back(cur);
+            const int e = edgeid(prev, cur);
+            int next = -1;
+            for (auto& a : adj[cur])
+                if (a.second != e && onface(a.second, f)) next = a.first;
+            prev = cur;
+            cur = next;
+            if (cyc.size() > 6 || cur < 0) return {};
+        }
+        return cyc;
+    }
+
+    /* Hash for bucketing closed graphs before any isomorphism test.
+     * Each face is labelled by its size and the cyclic sequence of its
+     * neighbours' sizes (up to rotation and reflection), then again by the
+     * cyclic sequence of the neighbours' labels; the hash combines nhex with
+     * the multiset of these labels. So it sees the triangle's and squares'
+     * neighbours, pentagon adjacencies, and a bit more.
+     * Only a 3-connected graph has a unique embedding (up to reflection), so
+     * a graph with two faces sharing two edges (a 2-edge cut) gets the
+     * fallback hash, which depends only on nhex. */
+    static uint64_t mix(uint64_t h, uint64_t x) {
+        h ^= x + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        return h * 0xff51afd7ed558ccdULL;
+    }
+
+    uint64_t fallback() const {
+        return mix(0, G.nhex);
+    }
 
-        if (G.openfaces.empty()) {
-            if (G.sizefinal() && G.faces.size() <= MAX_FACES) {
-                G.canongraph();
-                if (canonslns.emplace(G.canong.e, G.canong.e + G.canong.nde).second)
-                    ++nsuccess[G.nhex];
-                /* To write graph6 output, #include "gtools.h" and:
-                    writeg6_sg(stdout, &G.canong);
-                 */
+    uint64_t invariant() const {
+        const int nf = G.faces.size();
+        vector<vector<int>> nbrs(nf);  // neighbouring faces, in cyclic order
+        for (int f = 0; f < nf; ++f) {
+            const edge& e = G.edges[G.faces[f][0]];
+            const vector<int> cyc = cycle(f, e.v1, e.v2);
+            if (cyc.size() != G.faces[f].size())
+                return fallback();
+            for (uint i = 0; i < cyc.size(); ++i) {
+                const int g = otherface(edgeid(cyc[i], cyc[(i+1) % cyc.size()]), f);
+                if (std::find(nbrs[f].begin(), nbrs[f].end(), g) != nbrs[f].end())
+                    return fallback();
+                nbrs[f].push_back(g);
             }
-            pop = true;
-            continue;
         }
 
-        if (graphStack.size() > MAX_FACES - 4) {
-            pop = true;
-            continue;
+        auto dihedralmin = [](vector<uint64_t>& seq) {
+            const uint k = seq.size();
+            vector<uint64_t> best = seq, cand(k);
+            for (int dir = 0; dir < 2; ++dir) {
+                for (uint r = 0; r < k; ++r) {
+                    for (uint i = 0; i < k; ++i)
+                        cand[i] = seq[(r + i) % k];
+                    if (cand < best) best = cand;
+                }
+                std::reverse(seq.begin(), seq.end());
+            }
+            seq = best;
+        };
+        vector<uint64_t> label(nf), next(nf), seq;
+        for (int f = 0; f < nf; ++f)
+            label[f] = G.faces[f].size();
+        for (int round = 0; round < 2; ++round) {
+            for (int f = 0; f < nf; ++f) {
+                seq.clear();
+                for (int g : nbrs[f])
+                    seq.push_back(label[g]);
+                dihedralmin(seq);
+                uint64_t h = mix(label[f], seq.size());
+                for (uint64_t x : seq)
+                    h = mix(h, x);
+                next[f] = h;
+            }
+            label.swap(next);
         }
-        if (G.openfaces.size() == 1) {
-            pop = true;
-            continue;
+        std::sort(label.begin(), label.end());
+        uint64_t h = fallback();
+        for (uint64_t x : label)
+            h = mix(h, x);
+        return h == fallback() ? h + 1 : h;
+    }
+
+    /* Planar code: number the vertices breadth first from the dart u -> v,
+     * with face f on its left, listing each vertex's other two neighbours
+     * left turn first. Two embedded graphs are isomorphic (allowing a
+     * reflection) iff some start gives both the same code; since the
+     * triangle is unique, the starts on it (six darts, two sides each)
+     * are the only ones worth trying.
+     * This works for an open patch too: a vertex on its boundary with only
+     * two edges lists 0 for the one still to come, on the open side.
+     * If target is given, stop as soon as the code departs from it. */
+    typedef vector<uint16_t> Code;
+
+    /* The two vertices on from the dart u -> v (face f on its left), left
+     * turn first, and the face on the left of each new dart. On the open
+     * side of a boundary vertex the neighbour is 0 and the face unset. */
+    void turns(int u, int v, int f, int w[2], int sides[2]) const {
+        int te[2], k = 0;
+        for (auto& a : adj[v])
+            if (a.first != u) {
+                w[k] = a.first;
+                te[k++] = a.second;
+            }
+        if (k == 1) {
+            w[1] = 0;
+            if (onface(te[0], f)) {
+                sides[0] = f;
+            } else {
+                sides[1] = otherface(te[0], otherface(edgeid(u, v), f));
+                std::swap(w[0], w[1]);
+            }
+        } else {
+            if (!onface(te[0], f)) {
+                std::swap(w[0], w[1]);
+                std::swap(te[0], te[1]);
+            }
+            sides[0] = f;
+            sides[1] = otherface(te[0], f);
         }
-        if (!G.sizecheck()) {
-            pop = true;
-            continue;
+    }
+
+    bool code(int u0, int v0, int f0, Code& out, const Code* target = nullptr) const {
+        static_assert(2*MAX_FACES < 65536, "Code labels are 16 bits");
+        vector<int> lab(G.numverts + 1, 0);
+        vector<std::tuple<int,int,int>> queue;
+        int next = 1;
+        lab[v0] = next++;
+        lab[u0] = next++;
+        queue.emplace_back(u0, v0, f0);
+        queue.emplace_back(v0, u0, otherface(edgeid(u0, v0), f0));
+        out.clear();
+        for (uint i = 0; i < queue.size(); ++i) {
+            int u, v, f;
+            std::tie(u, v, f) = queue[i];
+            int nb[2], sides[2];
+            turns(u, v, f, nb, sides);
+            for (int j = 0; j < 2; ++j) {
+                const int w = nb[j];
+                if (w && !lab[w]) {
+                    lab[w] = next++;
+                    queue.emplace_back(v, w, sides[j]);
+                }
+                if (target && (*target)[out.size()] != lab[w])
+                    return false;
+                out.push_back(lab[w]);
+            }
         }
-        
+        return true;
+    }
+
+    /* The code from a fixed start: dart 1 -> 3, triangle on the left */
+    Code code() const {
+        Code c;
+        code(1, 3, 0, c);
+        return c;
+    }
+
+    /* Is this graph isomorphic to the one with the given code? */
+    bool matches(const Code& target) const {
+        Code scratch;
+        scratch.reserve(target.size());
+        for (int e = 0; e < 3; ++e) {
+            const edge& te = G.edges[e];
+            for (int f : {edgefaces[e].first, edgefaces[e].second})
+                if (code(te.v1, te.v2, f, scratch, &target) ||
+                    code(te.v2, te.v1, f, scratch, &target))
+                    return true;
+        }
+        return false;
+    }
+
+    /* Could the graph this patch grows into have the reflection that fixes
+     * the triangle's edge a-b (swapping a and b)? Walk out from that edge as
+     * code() does, and at once walk the mirror image, from b -> a: each
+     * vertex met must pair with the same one every time, and faces paired
+     * must agree in size, an open one being shorter than its closed
+     * partner. Only where both sides are built is there anything to check;
+     * on a closed graph, passing means the reflection is an automorphism. */
+    bool mirrors(int a, int b) const {
+        vector<int> sigma(G.numverts + 1, 0);
+        vector<bool> open(G.faces.size(), false);
+        for (int o : G.openfaces)
+            open[o] = true;
+        auto fits = [&](int f, int g) {
+            const uint lf = G.faces[f].size(), lg = G.faces[g].size();
+            if (open[f] && open[g])
+                return true;
+            if (open[f] || open[g])
+                return open[f] ? lf < lg : lg < lf;
+            return lf == lg;
+        };
+        vector<std::array<int,6>> queue;  // a dart and its image, as in code()
+        sigma[a] = b;
+        sigma[b] = a;
+        const int o = otherface(edgeid(a, b), 0);
+        queue.push_back({a, b, 0, b, a, 0});
+        queue.push_back({b, a, o, a, b, o});
+        for (uint i = 0; i < queue.size(); ++i) {
+            const std::array<int,6> q = queue[i];
+            int w[2], ws[2], m[2], ms[2];
+            turns(q[0], q[1], q[2], w, ws);
+            turns(q[3], q[4], q[5], m, ms);
+            for (int j = 0; j < 2; ++j) {
+                if (!w[j] || !m[j])
+                    continue;
+                if (!fits(ws[j], ms[j]))
+                    return false;
+                if (sigma[w[j]] == m[j])
+                    continue;
+                if (sigma[w[j]] || sigma[m[j]])
+                    return false;
+                sigma[w[j]] = m[j];
+                sigma[m[j]] = w[j];
+                queue.push_back({q[1], w[j], ws[j], q[4], m[j], ms[j]});
+            }
+        }
+        return true;
+    }
+};
+
+/* Might G grow into a graph with a mirror symmetry? The triangle is unique,
+ * so an automorphism fixes it; one of order 3 would have to fix or permute
+ * the two squares, which it can't, so the only symmetries there are are
+ * reflections through the triangle, each fixing one of its edges. */
+bool mirrored(const GraphState& G) {
+    const Embedding E(G);
+    for (int e = 0; e < 3; ++e)
+        if (E.mirrors(G.edges[e].v1, G.edges[e].v2))
+            return true;
+    return false;
+}
+
+/* Partial patches seen, level by level. The search below a state is fixed by
+ * its patch and by where openfaces starts (chooseFace breaks ties by that
+ * order), so the key is the patch's planar code from the first dart of
+ * openfaces[0], with that face on its left: states with the same key at the
+ * same depth have isomorphic subtrees, and the second one can only find
+ * graphs the first did. Only for a dedup store; --orderly keeps each graph
+ * on just one of its paths, which may be the skipped one.
+ * Past the byte budget, all levels are cleared. */
+struct IsoCache {
+    vector<std::unordered_set<std::string>> levels;
+    size_t budget, bytes = 0;
+    unsigned long nlookups = 0, nhits = 0, nstored = 0, nflushes = 0;
+
+    explicit IsoCache(size_t b) : budget(b) {}
+
+    /* Has a patch like G's been seen at this depth? If not, remember it. */
+    bool seen(const GraphState& G, size_t depth) {
+        ++nlookups;
+        const Embedding E(G);
+        const edge& e = G.edges[G.faces[G.openfaces[0]][0]];
+        Embedding::Code c;
+        E.code(e.v1, e.v2, G.openfaces[0], c);
+        std::string key((const char *)c.data(), c.size() * sizeof c[0]);
+        if (levels.size() <= depth)
+            levels.resize(depth + 1);
+        if (levels[depth].count(key)) {
+            ++nhits;
+            return true;
+        }
+        bytes += key.size() + 64;  // about what a node costs
+        if (bytes > budget) {
+            for (auto& l : levels)
+                std::unordered_set<std::string>().swap(l);
+            bytes = key.size() + 64;
+            ++nflushes;
+        }
+        levels[depth].insert(std::move(key));
+        ++nstored;
+        return false;
+    }
+
+    void clear() {
+        levels.clear();
+        bytes = 0;
+    }
+};
+
+/* Orderly generation, after McKay's canonical construction path.
+ * Below the seed (triangle, with a hexagon across edge {1,3}) the search is
+ * deterministic: chooseFace() picks the face, and the shape of the finished
+ * graph decides which method closes it. So a closed graph, together with a
+ * placement of the seed on it, determines the whole path to it, down to the
+ * final addEdges method and face. The placements are the triangle edges
+ * which border a hexagon, each in two orientations; placements related by an
+ * automorphism give the same path. The search needn't reach the graph from
+ * every placement: from some, a face would have to close in a shape none of
+ * the methods makes. So no placement can be ruled out beforehand, say by the
+ * sizes of the faces round the triangle: a graph reached only from the ones
+ * ruled out would be lost.
+ * A graph is accepted only if the path which built it is the least of the
+ * paths from all its placements, comparing the edge lists (in the order the
+ * edges were added.) Each isomorphism class is then emitted exactly once,
+ * with nothing stored, so subtrees can be run independently. */
+struct CanonPath : Embedding {
+    explicit CanonPath(const GraphState& g) : Embedding(g) {}
+
+    /* Follow the search from placement (a, c) of seed vertices 1, 3.
+     * Returns -1, 0, 1 as the path's edge list is less than, equal to, or
+     * greater than G's own; 2 if the search never reaches G this way.
+     * Once the path is known to differ it is only followed (if it's less,
+     * or whole is set) far enough to see that the search really takes it;
+     * a greater one is otherwise given up at once, as 1. */
+    int replay(int a, int c, bool whole = false) const {
+        int z = -1;
+        for (auto& t : adj[a])
+            for (auto& u : adj[c])
+                if (t.first == u.first) z = t.first;
+        const int ac = edgeid(a, c);
+        const int hexf = edgefaces[ac].first ? edgefaces[ac].first : edgefaces[ac].second;
+        if (z < 0 || G.faces[hexf].size() != 6)
+            return 2;
+        vector<int> hex = cycle(hexf, a, c);
+        if (hex.size() != 6) return 2;
+
+        vector<int> phi(2*G.numverts + 2, 0), inv(G.numverts + 1, 0);
+        auto assign = [&](int pv, int gv) { phi[pv] = gv; inv[gv] = pv; };
+        assign(1, a);
+        assign(2, z);
+        assign(3, c);
+        for (int i = 4; i <= 7; ++i)
+            assign(i, hex[i-2]);
+
+        GraphState S = seed;
+        int cmp = 0;
+        uint ecmp = 0;
+        auto compare = [&]() {
+            for (; cmp == 0 && ecmp < S.edges.size(); ++ecmp) {
+                const edge &se = S.edges[ecmp], &ge = G.edges[ecmp];
+                if (se.v1 != ge.v1) cmp = se.v1 < ge.v1 ? -1 : 1;
+                else if (se.v2 != ge.v2) cmp = se.v2 < ge.v2 ? -1 : 1;
+            }
+        };
+        compare();
+        for (size_t depth = 1; cmp <= 0 || whole; ++depth) {
+            const int n = S.openfaces.size();
+            const int oF = S.chosenFace;
+            const deque<int>& F = S.faces[S.openfaces[oF]];
+            const int L = F.size();
+            const int v0 = S.edges[F[0]].v1, v1 = S.edges[F[0]].v2;
+            // the edge at v0 not yet in the patch is on the closed-up F
+            int w1 = 0, w2 = 0;
+            for (const edge& e : S.edges) {
+                int w = e.v1 == v0 ? e.v2 : e.v2 == v0 ? e.v1 : 0;
+                if (w) (w1 ? w2 : w1) = w;
+            }
+            int eout = -1;
+            for (auto& t : adj[phi[v0]])
+                if (t.first != phi[w1] && t.first != phi[w2]) eout = t.second;
+            const int e0 = edgeid(phi[v0], phi[v1]);
+            int fG = -1;
+            for (int f : {edgefaces[e0].first, edgefaces[e0].second})
+                if (onface(eout, f)) fG = f;
+            vector<int> cyc = fG < 0 ? vector<int>{} : cycle(fG, phi[v0], phi[v1]);
+            const int k = cyc.size() - L;
+            if (k < 1 || k > 4) return 2;
+            for (int i = 1; i < L; ++i)
+                if (cyc[i] != phi[S.edges[F[i]].v1]) return 2;
+            const int q1 = k > 1 ? inv[cyc[L+1]] : 0,
+                      q2 = k > 2 ? inv[cyc[L+2]] : 0,
+                      q3 = k > 3 ? inv[cyc[L+3]] : 0;
+
+            auto face = [&](int d) -> const deque<int>& {
+                return S.faces[S.openfaces[(oF + d + 3*n) % n]];
+            };
+            auto startof = [&](const deque<int>& f) { return S.edges[f[0]].v1; };
+            auto endof = [&](const deque<int>& f) { return S.edges[f.back()].v2; };
+            vector<int> meths, fresh;
+            switch (k) {
+                case 1:
+                    meths = {1};
+                    break;
+                case 2:
+                    if (!q1) meths = {2}, fresh = {L+1};
+                    break;
+                case 3:
+                    if (!q1 && !q2) meths = {5}, fresh = {L+2, L+1};
+                    else if (q1 && q2) {
+                        if (n > 2 && q1 == endof(face(1)) && q2 == endof(face(2)))
+                            meths.push_back(3);
+                        if (n > 2 && q1 == startof(face(-2)) && q2 == startof(face(-1)))
+                            meths.push_back(4);
+                    }
+                    break;
+                case 4:
+                    if (!q1 && !q2 && !q3) meths = {10}, fresh = {L+3, L+2, L+1};
+                    else if (q1 && q2 && q3) {
+                        if (n > 2 && q1 == endof(face(1)) && q3 == endof(face(2))
+                                  && q2 == S.edges[face(2)[0]].v2)
+                            meths.push_back(6);
+                        if (n > 2 && q1 == startof(face(-2)) && q3 == startof(face(-1))
+                                  && q2 == S.edges[face(-2)[0]].v2)
+                            meths.push_back(7);
+                    } else if (q1 && q2 && !q3) {
+                        if (n > 2 && q1 == endof(face(1)) && q2 == endof(face(2)))
+                            meths = {8}, fresh = {L+3};
+                    } else if (!q1 && q2 && q3) {
+                        if (n > 2 && q2 == startof(face(-2)) && q3 == startof(face(-1)))
+                            meths = {9}, fresh = {L+1};
+                    }
+                    break;
+            }
+            int meth = 0;
+            for (int m : meths)
+                if (S.isValid(oF, m)) {
+                    meth = m;
+                    break;
+                }
+            if (!meth) return 2;
+
+            const int oldverts = S.numverts;
+            const uint oldedges = S.edges.size();
+            S.medgadd = meth;
+            S.addEdges();
+            for (uint i = 0; i < fresh.size(); ++i)
+                assign(oldverts + 1 + i, cyc[fresh[i]]);
+            for (uint i = oldedges; i < S.edges.size(); ++i)
+                if (edgeid(phi[S.edges[i].v1], phi[S.edges[i].v2]) < 0)
+                    return 2;
+            compare();
+
+            if (S.openfaces.empty())
+                return S.edges.size() == G.edges.size() ? cmp : 2;
+            // on the way to G, within the limits, pruning never cuts
+            if (!whole && prune(S, depth))
+                return 2;
+            S.chooseFace();
+        }
+        return 1;
+    }
+
+    bool canonical() const {
+        for (int e = 0; e < 3; ++e) {
+            const edge& te = G.edges[e];
+            if (replay(te.v1, te.v2) < 0 || replay(te.v2, te.v1) < 0)
+                return false;
+        }
+        return true;
+    }
+
+    /* The placements the search reaches G from, G being one it closed (so
+     * from (1, 3)). Without the dedup store, it closes G once for each, or
+     * once for two that a symmetry swaps. Not every placement reaches G:
+     * from some, closing the chosen face takes a shape the methods don't
+     * have. */
+    int reached() const {
+        auto across = [&](int u, int v) { return G.faces[otherface(edgeid(u, v), 0)].size(); };
+        int n = 1;
+        for (int a = 1; a <= 3; ++a)
+            for (int c = 1; c <= 3; ++c)  // the triangle is 1, 2, 3
+                if (a != c && !(a == 1 && c == 3) && across(a, c) == 6)
+                    n += replay(a, c, true) != 2;
+        return n;
+    }
+
+    static GraphState seed;
+};
+
+GraphState CanonPath::seed;
+
+/* Binary I/O, for checkpoints: plain values, and vectors of them */
+template<class T> void put(FILE *f, const T& x) {
+    fwrite(&x, sizeof x, 1, f);
+}
+template<class T> void put(FILE *f, const vector<T>& v) {
+    put(f, (uint64_t)v.size());
+    fwrite(v.data(), sizeof(T), v.size(), f);
+}
+template<class T> bool get(FILE *f, T& x) {
+    return fread(&x, sizeof x, 1, f) == 1;
+}
+/* Read in pieces, so that a corrupt length fails at the end of the file
+ * rather than asking for that much memory first */
+template<class T> bool get(FILE *f, vector<T>& v) {
+    uint64_t n;
+    if (!get(f, n))
+        return false;
+    v.clear();
+    while (v.size() < n) {
+        const size_t at = v.size(), k = std::min<uint64_t>(n - at, 1 << 16);
+        v.resize(at + k);
+        if (fread(v.data() + at, sizeof(T), k, f) != k)
+            return false;
+    }
+    return true;
+}
+
+/* Finish f, written as tmp, and rename it over path. The data is synced
+ * before the rename and the directory after, so that after a crash or a
+ * power cut path holds the old file or the whole new one, never a torn
+ * one. False on any error, with errno set. */
+bool replacefile(FILE *f, const std::string& tmp, const char *path) {
+    bool ok = !ferror(f) && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path))
+        return false;
+    const char *slash = strrchr(path, '/');
+    const std::string dir = !slash ? "." : slash == path ? "/" : std::string(path, slash);
+    const int fd = open(dir.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/* Dedup store for closed graphs, with lazy canonicalisation.
+ * Graphs are bucketed by nhex and Embedding::invariant(). The first graph in
+ * a bucket is kept as its planar code from one fixed start, which is cheap.
+ * Another graph in the same bucket is compared against those codes from
+ * each of its starts on the triangle: this decides isomorphism exactly, and
+ * isomorphic copies are most of what arrives, since the search builds each
+ * graph several times over. Nauty is only needed for graphs whose embedding
+ * isn't unique (the fallback bucket); there too, the first graph is stored
+ * as is, and it is canonicalised only when a second one arrives. */
+struct SolutionStore {
+    struct Bucket {
+        vector<Embedding::Code> codes;
+        vector<edge> raw;  // fallback only: sole occupant, not canonicalised
+        int rawverts = 0;
+        std::set<vector<int>> canon;
+    };
+    vector<std::unordered_map<uint64_t, Bucket>> levels;
+    bool nautyonly;  // put everything through nauty, as the fallback bucket
+    unsigned long ngraphs = 0, nnauty = 0, ncompared = 0;
+    size_t nfreed = 0, nfreedbuckets = 0;  // from released levels
+
+    explicit SolutionStore(bool nauty = false) : nautyonly(nauty) {}
+
+    /* The best nauty invariant depends on the graph size (see the timings at
+     * the top), so each vertex count starts with a trial: the first
+     * TRIAL_GRAPHS graphs are canonicalised under every option set, timed,
+     * and stored in their form under REF_CONFIG. Then the fastest set is
+     * locked in for that size; if it isn't REF_CONFIG, the forms stored so
+     * far are redone with it, so all forms of one size stay comparable. */
+    struct NautyConfig {
+        const char *name;
+        void (*invarproc)(graph*,int*,int*,int,int,int,int*,int,boolean,int,int);
+        int invararg;
+        boolean schreier;
+    };
+    static const NautyConfig configs[];
+    static const int NUM_CONFIGS, REF_CONFIG, TRIAL_GRAPHS;
+    struct Tuning {
+        int chosen = -1, trials = 0;
+        vector<double> secs = vector<double>(NUM_CONFIGS);
+    };
+    vector<Tuning> tuning;  // by vertex count
+    unsigned long ntrial = 0;
+
+    static vector<int> canonform(int numverts, const vector<edge>& edges, int config) {
+        optionblk& options = GraphState::options;
+        options.invarproc = configs[config].invarproc;
+        options.invararg = configs[config].invararg;
+        options.schreier = configs[config].schreier;
+        GraphState::canongraph(numverts, edges);
+        const sparsegraph& cg = GraphState::canong;
+        return vector<int>(cg.e, cg.e + cg.nde);
+    }
+
+    vector<int> canonform(int numverts, const vector<edge>& edges) {
+        if (tuning.size() <= (uint)numverts)
+            tuning.resize(numverts + 1);
+        Tuning& t = tuning[numverts];
+        if (t.chosen >= 0)
+            return canonform(numverts, edges, t.chosen);
+
+        vector<int> form;
+        for (int i = 0; i < NUM_CONFIGS; ++i) {
+            const int c = (i + t.trials) % NUM_CONFIGS; // vary who goes first
+            const auto start = std::chrono::steady_clock::now();
+            vector<int> f = canonform(numverts, edges, c);
+            t.secs[c] += std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start).count();
+            if (c == REF_CONFIG)
+                form.swap(f);
+        }
+        ++ntrial;
+        if (++t.trials == TRIAL_GRAPHS) {
+            t.chosen = std::min_element(t.secs.begin(), t.secs.end()) - t.secs.begin();
+            fprintf(stderr, "%d vertices: using %s (%.1f us per graph; %s %.1f us)\n",
+                    numverts, configs[t.chosen].name, 1e6 * t.secs[t.chosen] / t.trials,
+                    configs[REF_CONFIG].name, 1e6 * t.secs[REF_CONFIG] / t.trials);
+            if (t.chosen != REF_CONFIG)
+                recanon(numverts, t.chosen);
+        }
+        return form;
+    }
+
+    /* Redo the stored forms with numverts vertices under another config */
+    void recanon(int numverts, int config) {
+        const uint nhex = numverts / 2 - 6;
+        if (levels.size() <= nhex)
+            return;
+        for (auto& kb : levels[nhex]) {
+            std::set<vector<int>> redone;
+            for (const vector<int>& form : kb.second.canon) {
+                vector<edge> edges;
+                for (int v = 0; v < numverts; ++v)
+                    for (int j = 3*v; j < 3*v + 3; ++j)
+                        if (form[j] > v)
+                            edges.emplace_back(v + 1, form[j] + 1);
+                redone.insert(canonform(numverts, edges, config));
+                ++nnauty;
+            }
+            kb.second.canon.swap(redone);
+        }
+    }
+
+    /* True if G is new */
+    bool insert(const GraphState& G) {
+        ++ngraphs;
+        if (levels.size() <= (uint)G.nhex)
+            levels.resize(G.nhex + 1);
+        const Embedding emb(G);
+        const uint64_t key = nautyonly ? emb.fallback() : emb.invariant();
+        Bucket& b = levels[G.nhex][key];
+        if (key != emb.fallback()) {
+            for (const Embedding::Code& c : b.codes) {
+                ++ncompared;
+                if (emb.matches(c))
+                    return false;
+            }
+            b.codes.push_back(emb.code());
+            return true;
+        }
+        if (b.canon.empty() && b.raw.empty()) {
+            b.raw = G.edges;
+            b.rawverts = G.numverts;
+            return true;
+        }
+        if (!b.raw.empty()) {
+            b.canon.insert(canonform(b.rawverts, b.raw));
+            ++nnauty;
+            vector<edge>().swap(b.raw);
+        }
+        ++nnauty;
+        return b.canon.insert(canonform(G.numverts, G.edges)).second;
+    }
+
+    /* Everything, for a checkpoint: counters, nauty tuning and the levels */
+    void save(FILE *f) const {
+        put(f, vector<uint64_t>{ ngraphs, nnauty, ncompared, ntrial, nfreed, nfreedbuckets });
+        put(f, (uint64_t)tuning.size());
+        for (const Tuning& t : tuning) {
+            put(f, vector<int32_t>{ t.chosen, t.trials });
+            put(f, t.secs);
+        }
+        put(f, (uint64_t)levels.size());
+        for (auto& lev : levels) {
+            put(f, (uint64_t)lev.size());
+            for (auto& kb : lev) {
+                const Bucket& b = kb.second;
+                put(f, kb.first);
+                put(f, (uint64_t)b.codes.size());
+                for (const Embedding::Code& c : b.codes)
+                    put(f, c);
+                vector<int32_t> raw{ b.rawverts };
+                for (const edge& e : b.raw) {
+                    raw.push_back(e.v1);
+                    raw.push_back(e.v2);
+                }
+                put(f, raw);
+                put(f, (uint64_t)b.canon.size());
+                for (const vector<int>& form : b.canon)
+                    put(f, form);
+            }
+        }
+    }
+
+    bool load(FILE *f) {
+        vector<uint64_t> n;
+        if (!get(f, n) || n.size() != 6)
+            return false;
+        ngraphs = n[0], nnauty = n[1], ncompared = n[2], ntrial = n[3];
+        nfreed = n[4], nfreedbuckets = n[5];
+        uint64_t size;
+        if (!get(f, size))
+            return false;
+        tuning.resize(size);
+        for (Tuning& t : tuning) {
+            vector<int32_t> ct;
+            if (!get(f, ct) || ct.size() != 2 || !get(f, t.secs)
+                            || t.secs.size() != (uint)NUM_CONFIGS)
+                return false;
+            t.chosen = ct[0], t.trials = ct[1];
+        }
+        if (!get(f, size))
+            return false;
+        levels.assign(size, {});
+        for (auto& lev : levels) {
+            uint64_t nb;
+            if (!get(f, nb))
+                return false;
+            while (nb--) {
+                uint64_t key, count;
+                if (!get(f, key) || !get(f, count))
+                    return false;
+                Bucket& b = lev[key];
+                b.codes.resize(count);
+                for (Embedding::Code& c : b.codes)
+                    if (!get(f, c))
+                        return false;
+                vector<int32_t> raw;
+                if (!get(f, raw) || raw.empty())
+                    return false;
+                b.rawverts = raw[0];
+                for (uint i = 1; i + 1 < raw.size(); i += 2)
+                    b.raw.emplace_back(raw[i], raw[i+1]);
+                if (!get(f, count))
+                    return false;
+                while (count--) {
+                    vector<int> form;
+                    if (!get(f, form))
+                        return false;
+                    b.canon.insert(b.canon.end(), form);
+                }
+            }
+        }
+        return true;
+    }
+
+    /* No graph of this size can turn up any more: free its level */
+    void release(uint nhex) {
+        if (levels.size() <= nhex)
+            return;
+        for (auto& b : levels[nhex])
+            nfreed += b.second.codes.size() + b.second.canon.size() + !b.second.raw.empty();
+        nfreedbuckets += levels[nhex].size();
+        std::unordered_map<uint64_t, Bucket>().swap(levels[nhex]);
+    }
+
+    size_t size() const {
+        size_t n = nfreed;
+        for (auto& lev : levels)
+            for (auto& b : lev)
+                n += b.second.codes.size() + b.second.canon.size() + !b.second.raw.empty();
+        return n;
+    }
+
+    size_t nbuckets() const {
+        size_t n = nfreedbuckets;
+        for (auto& lev : levels)
+            n += lev.size();
+        return n;
+    }
+};
+
+const SolutionStore::NautyConfig SolutionStore::configs[] = {
+    {"no invariant",              NULL,         0, FALSE},
+    {"distances_sg 2",            distances_sg, 2, FALSE},
+    {"distances_sg 2, schreier",  distances_sg, 2, TRUE},
+    {"distances_sg 3",            distances_sg, 3, FALSE},
+    {"distances_sg 3, schreier",  distances_sg, 3, TRUE},
+};
+const int SolutionStore::NUM_CONFIGS = sizeof(configs) / sizeof(configs[0]);
+const int SolutionStore::REF_CONFIG = 1;
+const int SolutionStore::TRIAL_GRAPHS = 300;
+
+/* A canonical form of a closed graph as text, "nhex c ..." or "nhex n ...",
+ * for comparing graphs found by different processes: the least planar code
+ * over the starts on the triangle, or for graphs whose embedding isn't
+ * unique, nauty's form under REF_CONFIG (fixed, unlike the tuned choice). */
+std::string canonstring(const GraphState& G) {
+    const Embedding emb(G);
+    vector<int> form;
+    char kind = 'c';
+    if (emb.invariant() == emb.fallback()) {
+        form = SolutionStore::canonform(G.numverts, G.edges, SolutionStore::REF_CONFIG);
+        kind = 'n';
+    } else {
+        Embedding::Code best, c;
+        for (int e = 0; e < 3; ++e) {
+            const edge& te = G.edges[e];
+            for (int f : {emb.edgefaces[e].first, emb.edgefaces[e].second})
+                for (int r = 0; r < 2; ++r) {
+                    emb.code(r ? te.v2 : te.v1, r ? te.v1 : te.v2, f, c);
+                    if (best.empty() || c < best)
+                        best.swap(c);
+                }
+        }
+        form.assign(best.begin(), best.end());
+    }
+    std::string s = std::to_string(G.nhex) + ' ' + kind;
+    for (int x : form)
+        s += ' ' + std::to_string(x);
+    return s;
+}
+
+/* The dual engine (--dual). The faces of a cubic plane graph are the
+ * vertices of a triangulation of the sphere, its vertices the triangles, and
+ * a face's size the vertex's degree. Two faces sharing two edges make a
+ * double edge, so edges are told apart by id, not by their ends.
+ * The triangulation is built out from the star of the triangle's vertex (0,
+ * with neighbours 1, 2, 3) one triangle at a time. The rest of the sphere is
+ * a set of holes, each a disc with a boundary of vertices and edges. Each
+ * step takes the boundary edge leaving the boundary vertex of highest degree
+ * and decides the third corner of the triangle beyond it. That is either a
+ * new vertex, or one already on the same hole, joined by new edges or by
+ * the boundary edges either side; a new edge across a hole splits it in
+ * two. Any triangulation with that star is built in exactly one way, so
+ * nothing is missed, and the dedup store sorts out the rest.
+ * Vertex 1 is kept of highest degree among 1, 2, 3, and 2 no higher than 3:
+ * any triangulation can be turned and reflected to fit, so this only cuts
+ * out repeats. */
+struct Triangulation {
+    struct Side { int v, e; };  // a boundary vertex, and the edge on to the next
+    vector<int> deg, occ;  // per vertex: edges, and places on hole boundaries
+    vector<std::array<int,2>> ends;  // per edge
+    vector<std::array<int,3>> tris;  // per triangle, its edges
+    vector<vector<Side>> holes;
+    int ndeg[7] = {};  // vertices finished, by degree
+
+    Triangulation() : deg{3, 3, 3, 3}, occ{0, 1, 1, 1},
+        ends{ {0,2}, {0,3}, {0,1}, {1,2}, {2,3}, {3,1} },
+        tris{ {2,3,0}, {0,4,1}, {1,5,2} },
+        holes{ { {1,3}, {2,4}, {3,5} } } {
+        ndeg[3] = 1;
+    }
+
+    /* Add the triangle beyond edge i of hole h. Its third corner is a new
+     * vertex if j < 0, else the one at place j of the hole, joined to the
+     * edge's start by the boundary edge before it if back, and to its end by
+     * the boundary edge after it if fwd, or else by new edges. False if that
+     * leaves a vertex of the wrong degree. */
+    bool add(int h, int i, int j, bool back, bool fwd, int maxf) {
+        const vector<Side> H = holes[h];
+        const int L = H.size();
+        const int u = H[i].v, w = H[(i + 1) % L].v, e = H[i].e;
+        auto newedge = [&](int a, int b) {
+            ends.push_back({a, b});
+            ++deg[a];
+            ++deg[b];
+            return (int)ends.size() - 1;
+        };
+        if (j < 0) {
+            const int x = deg.size();
+            deg.push_back(0);
+            occ.push_back(1);
+            const int g1 = newedge(u, x), g2 = newedge(x, w);
+            tris.push_back({e, g2, g1});
+            holes[h][i].e = g1;
+            holes[h].insert(holes[h].begin() + i + 1, Side{x, g2});
+            return deg[u] <= 6 && deg[w] <= 6 && roomy(maxf) && ordered();
+        }
+        const int x = H[j].v;
+        const int g1 = back ? H[(i + L - 1) % L].e : newedge(x, u),
+                  g2 = fwd ? H[(i + 1) % L].e : newedge(w, x);
+        tris.push_back({e, g2, g1});
+        vector<Side> A, B;  // from w round to x, closed by g2; from x round to u, by g1
+        if (!fwd) {
+            for (int k = (i + 1) % L; k != j; k = (k + 1) % L)
+                A.push_back(H[k]);
+            A.push_back({x, g2});
+        }
+        if (!back) {
+            for (int k = j; k != i; k = (k + 1) % L)
+                B.push_back(H[k]);
+            B.push_back({u, g1});
+        }
+        holes.erase(holes.begin() + h);
+        if (!A.empty())
+            holes.push_back(std::move(A));
+        if (!B.empty())
+            holes.push_back(std::move(B));
+        for (int v : {u, w, x}) {
+            if (deg[v] > 6)
+                return false;
+            occ[v] = 0;
+            for (const vector<Side>& K : holes)
+                for (const Side& s : K)
+                    occ[v] += s.v == v;
+            // finished: the triangle's is the only face under 4
+            if (!occ[v] && (deg[v] < 4 || ++ndeg[deg[v]] > (deg[v] == 4 ? N_SQ
+                                                           : deg[v] == 5 ? N_PENT : maxf)))
+                return false;
+        }
+        return roomy(maxf) && ordered();
+    }
+
+    /* A hole of two edges needs a vertex inside */
+    bool roomy(int maxf) const {
+        if ((int)deg.size() < maxf)
+            return true;
+        for (const vector<Side>& K : holes)
+            if (K.size() == 2)
+                return false;
+        return true;
+    }
+
+    /* Vertex 1 of highest degree among the triangle's neighbours, and 2 no
+     * higher than 3, so far as can be told yet */
+    bool ordered() const {
+        auto hi = [&](int v) { return occ[v] ? 6 : deg[v]; };
+        return hi(1) >= deg[2] && hi(1) >= deg[3] && hi(3) >= deg[2];
+    }
+
+    /* Every triangle that can go beyond the boundary edge leaving the
+     * boundary vertex of highest degree (the first such, on a tie) */
+    void grow(vector<Triangulation>& out, int maxf) const {
+        int h = 0, i = 0;
+        for (uint k = 0; k < holes.size(); ++k)
+            for (uint m = 0; m < holes[k].size(); ++m)
+                if (deg[holes[k][m].v] > deg[holes[h][i].v])
+                    h = k, i = m;
+        const vector<Side>& H = holes[h];
+        const int L = H.size();
+        auto child = [&](int j, bool back, bool fwd) {
+            out.push_back(*this);
+            if (!out.back().add(h, i, j, back, fwd, maxf))
+                out.pop_back();
+        };
+        if ((int)deg.size() < maxf)
+            child(-1, false, false);
+        for (int j = 0; j < L; ++j) {
+            if (H[j].v == H[i].v || H[j].v == H[(i + 1) % L].v)
+                continue;
+            const bool canback = j == (i + L - 1) % L, canfwd = j == (i + 2) % L;
+            for (int back = 0; back <= canback; ++back)
+                for (int fwd = 0; fwd <= canfwd; ++fwd)
+                    child(j, back, fwd);
+        }
+    }
+
+    GraphState dual() const {
+        return dual(deg.size(), ends, tris);
+    }
+
+    /* The cubic graph of a finished triangulation with vertex 0 the
+     * triangle: vertex t + 1 for triangle t, face v for vertex v. Edges 0, 1,
+     * 2 are those of the triangle (face 0), between the triangles 1, 2, 3
+     * round vertex 0, as in the seed; these are renumbered so that the face
+     * on edge {1,3} is the biggest of the three, where the seed has its
+     * hexagon. They already are, when built as above. */
+    static GraphState dual(int nv, vector<std::array<int,2>> ends,
+                           vector<std::array<int,3>> tris) {
+        GraphState G;
+        vector<std::array<int,2>> sides(ends.size(), {{-1, -1}});
+        auto findsides = [&]() {
+            for (auto& s : sides)
+                s = {{-1, -1}};
+            for (uint t = 0; t < tris.size(); ++t)
+                for (int e : tris[t])
+                    sides[e][sides[e][0] >= 0] = t;
+        };
+        findsides();
+        vector<int> degree(nv), star;  // star: the triangles round vertex 0
+        for (auto& u : ends) {
+            ++degree[u[0]];
+            ++degree[u[1]];
+        }
+        for (uint e = 0; e < ends.size(); ++e)
+            if (!ends[e][0] || !ends[e][1])
+                for (int t : sides[e])
+                    if (std::find(star.begin(), star.end(), t) == star.end())
+                        star.push_back(t);
+        std::sort(star.begin(), star.end());
+        auto between = [&](int s, int t) {  // the edge at 0 between two of them
+            for (uint e = 0; e < ends.size(); ++e)
+                if ((!ends[e][0] || !ends[e][1])
+                        && std::minmax(sides[e][0], sides[e][1]) == std::minmax(s, t))
+                    return (int)e;
+            return -1;
+        };
+        auto across = [&](int e) { return degree[ends[e][0] ? ends[e][0] : ends[e][1]]; };
+        int ring[3];
+        do {
+            ring[0] = between(star[0], star[1]);
+            ring[1] = between(star[1], star[2]);
+            ring[2] = between(star[2], star[0]);
+        } while (!(across(ring[2]) >= across(ring[0]) && across(ring[2]) >= across(ring[1]))
+                 && std::next_permutation(star.begin(), star.end()));
+        if (star[0] || star[1] != 1 || star[2] != 2 || ring[0] || ring[1] != 1 || ring[2] != 2) {
+            vector<int> tmap(tris.size(), -1), emap(ends.size(), -1);
+            int next = 3;
+            for (int k = 0; k < 3; ++k)
+                tmap[star[k]] = k;
+            for (int& m : tmap)
+                if (m < 0)
+                    m = next++;
+            next = 3;
+            for (int k = 0; k < 3; ++k)
+                emap[ring[k]] = k;
+            for (int& m : emap)
+                if (m < 0)
+                    m = next++;
+            vector<std::array<int,2>> E(ends.size());
+            vector<std::array<int,3>> T(tris.size());
+            for (uint e = 0; e < ends.size(); ++e)
+                E[emap[e]] = ends[e];
+            for (uint t = 0; t < tris.size(); ++t)
+                for (int k = 0; k < 3; ++k)
+                    T[tmap[t]][k] = emap[tris[t][k]];
+            ends.swap(E);
+            tris.swap(T);
+            findsides();
+        }
+        G.numverts = tris.size();
+        G.edges.clear();
+        for (auto& s : sides)
+            G.edges.emplace_back(std::min(s[0], s[1]) + 1, std::max(s[0], s[1]) + 1);
+        vector<vector<int>> at(nv);  // edges at each vertex
+        for (uint e = 0; e < ends.size(); ++e) {
+            at[ends[e][0]].push_back(e);
+            at[ends[e][1]].push_back(e);
+        }
+        G.faces.assign(nv, deque<int>());
+        G.nsq = G.npent = G.nhex = 0;
+        for (int v = 0; v < nv; ++v) {
+            // round v: from an edge, through a triangle on it, to its other edge at v
+            int e = at[v][0], t = sides[e][0];
+            do {
+                G.faces[v].push_back(e);
+                for (int f : tris[t])
+                    if (f != e && (ends[f][0] == v || ends[f][1] == v)) {
+                        e = f;
+                        break;
+                    }
+                t = sides[e][0] == t ? sides[e][1] : sides[e][0];
+            } while (e != at[v][0]);
+            G.countFace(G.faces[v]);
+        }
+        G.openfaces.clear();
+        return G;
+    }
+};
+
+/* The face-spiral engine (--spiral), after Fowler and Manolopoulos. A
+ * spiral lists the faces in an order where each after the first two is next
+ * to the one before and to the earliest face with edges still to place; a
+ * list of sizes then winds up into at most one graph. Here spirals start at
+ * the triangle and are wound a face at a time, depth first, trying each
+ * size for the next face, so a prefix that won't wind cuts off every spiral
+ * beginning with it. Winding is done in the dual, as for --dual: the faces
+ * are the vertices, and the patch so far is a disc whose boundary runs from
+ * the oldest face with edges to place round to the newest. Each new face
+ * joins the newest and the oldest, then goes on joining faces along the
+ * boundary past any of those that are finished. Not every graph has a
+ * spiral, so this misses some; --spiral-missed says which. */
+struct Spiral {
+    vector<int> need;  // per face: edges still to place
+    vector<std::array<int,2>> ends;  // per edge
+    vector<std::array<int,3>> tris;  // per triangle, its edges
+    deque<Triangulation::Side> rim;  // the boundary, oldest first; the last edge closes it
+    int nsq = 0, npent = 0;
+    bool shut = false;  // the sphere is covered
+
+    Spiral() : need{3} {}
+
+    /* Wind on a face of the given size. False if it doesn't fit. */
+    bool add(int size) {
+        const int k = need.size();
+        need.push_back(size);
+        nsq += size == 4;
+        npent += size == 5;
+        bool ok = nsq <= N_SQ && npent <= N_PENT;
+        auto link = [&](int a, int b) {
+            ends.push_back({a, b});
+            ok &= --need[a] >= 0;
+            ok &= --need[b] >= 0;
+            return (int)ends.size() - 1;
+        };
+        if (k == 1) {
+            const int e = link(0, 1);
+            rim = { {0, e}, {1, e} };
+            return ok;
+        }
+        Triangulation::Side& B = rim.back();
+        const int c = B.e, e1 = link(B.v, k);
+        int kf = link(k, rim.front().v);  // k's edge on to the oldest
+        tris.push_back({c, e1, kf});
+        B.e = e1;
+        while (ok && !shut && !need[rim.front().v]) {
+            const Triangulation::Side F = rim.front();
+            rim.pop_front();
+            if (rim.size() == 1) {
+                tris.push_back({kf, F.e, rim.back().e});
+                shut = true;
+            } else {
+                const int g = link(k, rim.front().v);
+                tris.push_back({kf, F.e, g});
+                kf = g;
+            }
+        }
+        while (ok && !shut && !need[rim.back().v]) {
+            const Triangulation::Side L = rim.back();
+            rim.pop_back();
+            if (rim.size() == 1) {
+                tris.push_back({rim.back().e, L.e, kf});
+                shut = true;
+            } else {
+                const int g = link(rim.back().v, k);
+                tris.push_back({rim.back().e, L.e, g});
+                rim.back().e = g;
+            }
+        }
+        if (shut)
+            return ok && std::count(need.begin(), need.end(), 0) == k + 1;
+        rim.push_back({k, kf});
+        return ok && need[k] > 0;
+    }
+
+    /* Every spiral one face longer, up to maxf faces */
+    void grow(vector<Spiral>& out, int maxf) const {
+        if ((int)need.size() >= maxf)
+            return;
+        for (int size = 6; size >= 4; --size) {
+            out.push_back(*this);
+            if (!out.back().add(size))
+                out.pop_back();
+        }
+    }
+
+    GraphState dual() const {
+        return Triangulation::dual(need.size(), ends, tris);
+    }
+};
+
+/* Below the seed the search is deterministic, so a state is named by the
+ * moves that led to it from the seed: at each step the open face chosen (an
+ * index to openfaces) and the method used on it. Each fits in a byte. As
+ * text, a path is "face.method" steps joined by commas; the seed's is "". */
+struct Move {
+    uint8_t face, meth;
+};
+typedef vector<Move> Path;
+
+/* The path to the state just below the top of the DFS stack */
+Path stackPath(const deque<GraphState>& graphStack) {
+    Path p;
+    for (const GraphState& S : graphStack)
+        p.push_back({ (uint8_t)S.chosenFace, (uint8_t)S.medgadd });
+    return p;
+}
+
+/* Replays p from the seed into G, pushing the states passed through onto
+ * graphStack if given, as the search would. G is left as addEdges() leaves
+ * it (chooseFace() not yet called.) False if a move isn't one the search
+ * makes: each face must be chooseFace()'s, each method valid, and no state
+ * on the way one that prune() cuts off. */
+bool replay(const Path& p, GraphState& G, deque<GraphState> *graphStack = NULL) {
+    G = GraphState{};
+    size_t depth = 0;
+    for (const Move& m : p) {
+        if (G.openfaces.empty())
+            return false;
         G.chooseFace();
+        if (m.face != G.chosenFace || m.meth < 1 || m.meth > NUM_METH)
+            return false;
+        G.medgadd = m.meth;
+        if (!G.isValid())
+            return false;
+        if (graphStack)
+            graphStack->push_back(G);
+        G.addEdges();
+        if (!G.openfaces.empty() && prune(G, ++depth))
+            return false;
+    }
+    return true;
+}
+
+std::string pathText(const Path& p) {
+    std::string s;
+    char step[12];
+    for (const Move& m : p) {
+        snprintf(step, sizeof step, "%s%d.%d", s.empty() ? "" : ",", m.face, m.meth);
+        s += step;
+    }
+    return s;
+}
+
+bool parsePath(const char *s, Path& p) {
+    p.clear();
+    while (*s) {
+        int face, meth, n;
+        if (sscanf(s, "%d.%d%n", &face, &meth, &n) != 2 || face < 0 || face > 255
+                                                          || meth < 0 || meth > 255)
+            return false;
+        p.push_back({ (uint8_t)face, (uint8_t)meth });
+        s += n;
+        if (*s == ',' && s[1])
+            ++s;
+        else if (*s)
+            return false;
+    }
+    return true;
+}
+
+/* The endgame tablebase: for each boundary (as in DeadEnds) of at most nopen
+ * open faces, the moves from it to every closure within the face limits, or
+ * none. Closures below minFaces aren't kept: the dead-end table skips
+ * subtrees with nothing but those, so a record couldn't be sure of them. Depth doesn't come into it: each move closes a face, so the depth cut
+ * never stops a closure the face limit allows. The first state with a
+ * boundary is searched and what it finds recorded; any later one replays the
+ * moves instead, giving the same graphs, built the same way. A boundary with
+ * more than maxpaths closures isn't kept.
+ * On disk (native byte order): "PLENDGM2", int32 params {maxFaces, minFaces,
+ * N_TRI, N_SQ, N_PENT, face rule}, uint64 nentries, then per entry its key as uint64[4] and
+ * its paths as a vector of paths. */
+const char endgameMagic[8] = {'P','L','E','N','D','G','M','2'};
+
+struct Endgame {
+    typedef DeadEnds::Key Key;
+    int nopen, maxpaths, minfaces;
+    std::unordered_map<Key, vector<Path>, DeadEnds::Hash> table;
+    /* States being recorded: level moves into the search, and below */
+    struct Pending {
+        size_t level;
+        Key key;
+        vector<Path> paths;
+        bool spoilt;
+    };
+    vector<Pending> pending;
+    unsigned long nlookups = 0, nhits = 0, nreplayed = 0, nrecorded = 0, ndropped = 0;
+
+    Endgame(int n, int m, int minf) : nopen(n), maxpaths(m), minfaces(minf) {}
+
+    /* The known closures from G's boundary, or NULL */
+    const vector<Path> *lookup(const GraphState& G) {
+        Key k;
+        if (G.openfaces.size() > (uint)nopen || !DeadEnds::key(G, 0, k))
+            return NULL;
+        ++nlookups;
+        const auto it = table.find(k);
+        if (it == table.end())
+            return NULL;
+        ++nhits;
+        return &it->second;
+    }
+
+    /* Record what's found below G, level moves into the search, if its
+     * boundary is one to keep */
+    void start(const GraphState& G, size_t level) {
+        Key k;
+        if (G.openfaces.size() <= (uint)nopen && DeadEnds::key(G, 0, k) && !table.count(k))
+            pending.push_back({ level, k, {}, false });
+    }
+
+    /* A closure, at the end of path p from the start of the search */
+    void found(const Path& p) {
+        for (Pending& r : pending) {
+            if (r.spoilt)
+                continue;
+            r.paths.emplace_back(p.begin() + r.level, p.end());
+            r.spoilt = r.paths.size() > (size_t)maxpaths;
+        }
+    }
+
+    /* Something below was skipped, so none of the records is whole */
+    void spoil() {
+        for (Pending& r : pending)
+            r.spoilt = true;
+    }
+
+    /* The states level or more moves into the search are done with */
+    void finish(size_t level) {
+        for (; !pending.empty() && pending.back().level >= level; pending.pop_back()) {
+            Pending& r = pending.back();
+            if (r.spoilt) {
+                ++ndropped;
+            } else {
+                table.emplace(r.key, std::move(r.paths));
+                ++nrecorded;
+            }
+        }
+    }
+
+    vector<int32_t> params() const {
+        return { maxFaces, minfaces, N_TRI, N_SQ, N_PENT, GraphState::facerule };
+    }
+
+    /* -1 if there's no file, 0 if it's not a table for these limits */
+    int load(const char *path) {
+        FILE *f = fopen(path, "rb");
+        if (!f)
+            return -1;
+        char magic[sizeof endgameMagic];
+        vector<int32_t> ps;
+        uint64_t n;
+        bool ok = fread(magic, 1, sizeof magic, f) == sizeof magic
+                    && !memcmp(magic, endgameMagic, sizeof magic)
+                    && get(f, ps) && ps == params() && get(f, n);
+        for (uint64_t i = 0; ok && i < n; ++i) {
+            Key k;
+            uint64_t npaths;
+            ok = fread(k.w, sizeof k.w[0], 4, f) == 4 && get(f, npaths);
+            vector<Path> paths(ok ? npaths : 0);
+            for (Path& p : paths)
+                ok = ok && get(f, p);
+            if (ok)
+                table.emplace(k, std::move(paths));
+        }
+        fclose(f);
+        return ok;
+    }
+
+    bool save(const char *path) const {
+        const std::string tmp = std::string(path) + ".tmp";
+        FILE *f = fopen(tmp.c_str(), "wb");
+        if (!f)
+            return false;
+        fwrite(endgameMagic, 1, sizeof endgameMagic, f);
+        put(f, params());
+        put(f, (uint64_t)table.size());
+        for (const auto& e : table) {
+            fwrite(e.first.w, sizeof e.first.w[0], 4, f);
+            put(f, (uint64_t)e.second.size());
+            for (const Path& p : e.second)
+                put(f, p);
+        }
+        return replacefile(f, tmp, path);
+    }
+};
+
+/* A GraphState flattened into one array, for states that wait a while (the
+ * BFS frontier): a deque costs far more than the few numbers it holds. */
+struct PackedState {
+    vector<uint16_t> d;
+
+    PackedState() {}
+    explicit PackedState(const GraphState& G) {
+        static_assert(3*MAX_FACES < 65536, "Packed fields are 16 bits");
+        d = { (uint16_t)G.numverts, (uint16_t)G.nsq, (uint16_t)G.npent,
+              (uint16_t)G.nhex, (uint16_t)G.medgadd, (uint16_t)G.chosenFace,
+              (uint16_t)G.edges.size() };
+        for (const edge& e : G.edges) {
+            d.push_back(e.v1);
+            d.push_back(e.v2);
+        }
+        d.push_back(G.faces.size());
+        for (auto& F : G.faces) {
+            d.push_back(F.size());
+            d.insert(d.end(), F.begin(), F.end());
+        }
+        d.push_back(G.openfaces.size());
+        d.insert(d.end(), G.openfaces.begin(), G.openfaces.end());
+        d.shrink_to_fit();
+    }
+
+    GraphState unpack() const {
+        GraphState G;
+        auto p = d.begin();
+        G.numverts = *p++;
+        G.nsq = *p++;
+        G.npent = *p++;
+        G.nhex = *p++;
+        G.medgadd = *p++;
+        G.chosenFace = *p++;
+        G.edges.clear();
+        for (int n = *p++; n; --n, p += 2)
+            G.edges.emplace_back(p[0], p[1]);
+        G.faces.resize(*p++);
+        for (auto& F : G.faces) {
+            const int len = *p++;
+            F.assign(p, p + len);
+            p += len;
+        }
+        G.openfaces.assign(p + 1, p + 1 + *p);
+        return G;
+    }
+};
+
+/* A frontier file lets a finished run be extended to more faces. It holds
+ * the counts, and every state the face limit cut off: branches pruned by
+ * depth or faces needed, and closed graphs with too many faces. Those are
+ * exactly the roots of the search a higher limit adds, and everything they
+ * lead to has more faces than the old limit, so no dedup store is needed to
+ * go on from them. Layout (native byte order):
+ *   "PLFRONT2", int32 maxFaces, int32 face rule, int32 ncounts,
+ *   int32 counts[ncounts],
+ *   uint64 nstates, then per state: uint16 depth, uint16 length, and the
+ *   PackedState data. */
+const char frontierMagic[8] = {'P','L','F','R','O','N','T','2'};
+
+bool cutoff(int why) {
+    return why == 1 || why == 5;
+}
+
+struct FrontierWriter {
+    FILE *f;
+    int maxFaces;
+    uint64_t nstates = 0;
+
+    FrontierWriter(const char *path, int maxF) : f(fopen(path, "wb")), maxFaces(maxF) {
+        if (f)
+            header(vector<int>(maxFaces - 7));  // counts filled in by finish()
+    }
+
+    void header(const vector<int>& counts) {
+        const int32_t n = counts.size();
+        vector<int32_t> c(counts.begin(), counts.end());
+        fwrite(frontierMagic, 1, sizeof frontierMagic, f);
+        fwrite(&maxFaces, sizeof(int32_t), 1, f);
+        fwrite(&GraphState::facerule, sizeof(int32_t), 1, f);
+        fwrite(&n, sizeof n, 1, f);
+        fwrite(c.data(), sizeof(int32_t), n, f);
+        fwrite(&nstates, sizeof nstates, 1, f);
+    }
+
+    void add(const GraphState& G, size_t depth) {
+        const PackedState P(G);
+        const uint16_t head[2] = { (uint16_t)depth, (uint16_t)P.d.size() };
+        fwrite(head, sizeof(uint16_t), 2, f);
+        fwrite(P.d.data(), sizeof(uint16_t), P.d.size(), f);
+        ++nstates;
+    }
+
+    /* False if anything failed to write */
+    bool finish(const vector<int>& counts) {
+        vector<int> c(counts.begin(), counts.begin() + maxFaces - 7);
+        rewind(f);
+        header(c);
+        const bool ok = !ferror(f);
+        return fclose(f) == 0 && ok;
+    }
+};
+
+struct FrontierReader {
+    FILE *f;
+    int maxFaces = 0, rule = 0;
+    vector<int> counts;
+    uint64_t nstates = 0;
+
+    /* Check for f and maxFaces > 0 afterwards. A face limit that no graph
+     * is within, or too big for PackedState, isn't taken. */
+    explicit FrontierReader(const char *path) : f(fopen(path, "rb")) {
+        char magic[sizeof frontierMagic];
+        int32_t maxF, r, n;
+        if (!f || fread(magic, 1, sizeof magic, f) != sizeof magic
+               || memcmp(magic, frontierMagic, sizeof magic)
+               || fread(&maxF, sizeof maxF, 1, f) != 1 || maxF <= 8 || 3*maxF >= 65536
+               || fread(&r, sizeof r, 1, f) != 1 || r < 0 || r >= GraphState::NUM_FACE_RULES
+               || fread(&n, sizeof n, 1, f) != 1 || n != maxF - 7)
+            return;
+        vector<int32_t> c(n);
+        if (fread(c.data(), sizeof(int32_t), n, f) != (size_t)n
+               || fread(&nstates, sizeof nstates, 1, f) != 1)
+            return;
+        counts.assign(c.begin(), c.end());
+        rule = r;
+        maxFaces = maxF;
+    }
+
+    bool next(GraphState& G, size_t& depth) {
+        uint16_t head[2];
+        if (fread(head, sizeof(uint16_t), 2, f) != 2)
+            return false;
+        PackedState P;
+        P.d.resize(head[1]);
+        if (fread(P.d.data(), sizeof(uint16_t), head[1], f) != head[1])
+            return false;
+        G = P.unpack();
+        depth = head[0];
+        return true;
+    }
+
+    ~FrontierReader() {
+        if (f)
+            fclose(f);
+    }
+};
+
+/* Knuth's estimator of the search tree, by random probes from the seed. At
+ * each state on a probe, all its children are made, as the search would;
+ * each counts with weight W, the inverse of the chance the probe got there,
+ * and the probe goes on to one of the children that aren't leaves, chosen
+ * uniformly (so W grows by their number). Summed over a probe, that's an
+ * unbiased estimate of the whole tree, and the mean over probes converges.
+ * Closed graphs are put through the orderly test, so they estimate distinct
+ * graphs, and the time taken over each state is weighted the same way, so
+ * the time is what an --orderly run would take.
+ * The cuts for a lower face limit M only cut more, so one set of probes
+ * serves all of them: a state's children are in the tree for M if M is at
+ * least the largest depth + 4 and faces.size() + morefaces() on its way
+ * down (its "req"). */
+struct Estimator {
+    enum { NODES, GRAPHS, SECS, NUM_SAMPLES };
+    int maxF;
+    std::mt19937_64 rng;
+    // per probe: nodes and seconds by the face limit, graphs by nhex
+    vector<double> x[NUM_SAMPLES];
+    // sums over probes, for the mean and its standard error
+    vector<double> sum[NUM_SAMPLES], sumsq[NUM_SAMPLES];
+    long nprobes = 0;
+
+    Estimator(int maxFaces, uint64_t seed) : maxF(maxFaces), rng(seed) {
+        for (int i = 0; i < NUM_SAMPLES; ++i) {
+            sum[i].resize(maxF + 1);
+            sumsq[i].resize(maxF + 1);
+        }
+    }
+
+    static double since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /* A probe from G (depth steps down, chooseFace() done), by default the
+     * seed; req as described above */
+    void probe(GraphState G = GraphState{}, size_t depth0 = 0, int req = 0) {
+        for (auto& v : x)
+            v.assign(maxF + 1, 0);
+        double W = 1;
+        for (size_t depth = depth0 + 1; ; ++depth) {
+            const auto start = std::chrono::steady_clock::now();
+            vector<GraphState> live;
+            vector<int> livereq;
+            int nkids = 0;
+            while (G.incMethod()) {
+                GraphState C = G;
+                C.addEdges();
+                ++nkids;
+                if (C.openfaces.empty()) {
+                    if (C.sizefinal() && C.faces.size() <= (uint)maxF) {
+                        // only runs up to C's size pay for its test
+                        const auto tstart = std::chrono::steady_clock::now();
+                        if (CanonPath(C).canonical())
+                            x[GRAPHS][C.nhex] += W;
+                        x[SECS][C.faces.size()] += W * since(tstart);
+                    }
+                    continue;
+                }
+                if (prune(C, depth))
+                    continue;
+                C.chooseFace();
+                livereq.push_back(std::max({ req, (int)depth + 4,
+                                             (int)C.faces.size() + C.morefaces() }));
+                live.push_back(std::move(C));
+            }
+            x[NODES][std::min(req, maxF)] += W * nkids;
+            x[SECS][std::min(req, maxF)] += W * since(start);
+            if (live.empty())
+                break;
+            const size_t k = std::uniform_int_distribution<size_t>(0, live.size() - 1)(rng);
+            W *= live.size();
+            G = std::move(live[k]);
+            req = livereq[k];
+        }
+        // the nodes and time of a run with face limit M: all those up to M
+        for (int M = 1; M <= maxF; ++M) {
+            x[NODES][M] += x[NODES][M-1];
+            x[SECS][M] += x[SECS][M-1];
+        }
+        for (int i = 0; i < NUM_SAMPLES; ++i)
+            for (int M = 0; M <= maxF; ++M) {
+                sum[i][M] += x[i][M];
+                sumsq[i][M] += x[i][M] * x[i][M];
+            }
+        ++nprobes;
+    }
+
+    /* The mean of sample i at M, and the half-width of its 95% interval */
+    std::pair<double,double> mean(int i, int M) const {
+        const double m = sum[i][M] / nprobes,
+                     var = std::max(0.0, sumsq[i][M] / nprobes - m * m);
+        return { m, 1.96 * sqrt(var / std::max(1L, nprobes - 1)) };
+    }
+};
+
+/* A plan splits the search into jobs of about known cost, for parallel or
+ * distributed runs. The search is expanded to a given depth; each state
+ * there is a job (named by its path), as is each graph closed on the way.
+ * Each job's cost is estimated by random probes below it, and the jobs are
+ * packed into groups of about equal cost, biggest first, each to the
+ * group with the least so far. A worker runs one group. */
+struct Plan {
+    struct Job {
+        Path path;
+        double cost;
+        int group;
+    };
+    vector<Job> jobs;
+    vector<double> load;  // estimated seconds per group
+
+    Plan(size_t depth, int ngroups, long nprobes, uint64_t seed) : load(ngroups) {
+        Estimator est(maxFaces, seed);
+        expand(GraphState{}, Path(), 0, depth, nprobes, est);
+        vector<Job*> order;
+        for (Job& j : jobs)
+            order.push_back(&j);
+        std::stable_sort(order.begin(), order.end(),
+                         [](const Job *a, const Job *b) { return a->cost > b->cost; });
+        for (Job *j : order) {
+            j->group = std::min_element(load.begin(), load.end()) - load.begin();
+            load[j->group] += j->cost;
+        }
+    }
+
+    /* The jobs at and below G, which is path.size() steps down (and has
+     * had chooseFace()), to the given depth */
+    void expand(GraphState G, Path path, int req, size_t depth, long nprobes,
+                Estimator& est) {
+        if (path.size() == depth) {
+            est = Estimator(maxFaces, est.rng());
+            for (long i = 0; i < nprobes; ++i)
+                est.probe(G, path.size(), req);
+            jobs.push_back({ path, est.mean(Estimator::SECS, maxFaces).first, 0 });
+            return;
+        }
+        while (G.incMethod()) {
+            GraphState C = G;
+            C.addEdges();
+            path.push_back({ (uint8_t)G.chosenFace, (uint8_t)G.medgadd });
+            if (C.openfaces.empty()) {
+                if (C.sizefinal() && C.faces.size() <= (uint)maxFaces)
+                    jobs.push_back({ path, 0, 0 });
+            } else if (!prune(C, path.size())) {
+                C.chooseFace();
+                expand(C, path, std::max({ req, (int)path.size() + 4,
+                                          (int)C.faces.size() + C.morefaces() }),
+                       depth, nprobes, est);
+            }
+            path.pop_back();
+        }
+    }
+
+    /* One line per job: group, estimated seconds, path ("-" for the seed's) */
+    bool write(const char *fname, size_t depth) const {
+        FILE *f = fopen(fname, "w");
+        if (!f)
+            return false;
+        fprintf(f, "# planar-fast plan: hex-max %d, depth %zu, %zu jobs in %zu groups\n",
+                maxFaces - 8, depth, jobs.size(), load.size());
+        for (uint g = 0; g < load.size(); ++g)
+            fprintf(f, "# group %u: %.3g s\n", g, load[g]);
+        for (const Job& j : jobs)
+            fprintf(f, "%d %.4g %s\n", j.group, j.cost,
+                    j.path.empty() ? "-" : pathText(j.path).c_str());
+        const bool ok = !ferror(f);
+        return fclose(f) == 0 && ok;
+    }
+
+    /* The jobs in a plan file; false if it can't be read */
+    static bool read(const char *fname, vector<Job>& jobs) {
+        FILE *f = fopen(fname, "r");
+        if (!f)
+            return false;
+        char line[4096], text[4096];
+        bool ok = true;
+        while (ok && fgets(line, sizeof line, f)) {
+            int g;
+            double cost;
+            Path p;
+            if (line[0] == '#')
+                continue;
+            ok = sscanf(line, "%d %lf %4095s", &g, &cost, text) == 3
+                 && (!strcmp(text, "-") || parsePath(text, p));
+            if (ok)
+                jobs.push_back({ p, cost, g });
+        }
+        fclose(f);
+        return ok;
+    }
+};
+
+/* For --queue --list: the write end of the pipe the parent waits on, and a
+ * SIGCHLD handler that wakes it there with a note that a worker exited */
+int wakefd = -1;
+const uint32_t WORKER_EXITED = UINT32_MAX;
+void onchild(int) {
+    const int saved = errno;
+    if (write(wakefd, &WORKER_EXITED, sizeof WORKER_EXITED) < 0) {}
+    errno = saved;
+}
+
+/* A job queue, for --queue and --merge. Each worker goes through the jobs of
+ * a plan, biggest first, and runs any it can get the lock on (DIR/job-N.lock,
+ * by flock, which goes with the process if it dies) and which has no result
+ * yet. Each job's distinct graphs are written to DIR/job-N.res, by way of a
+ * synced rename (see replacefile()), in the order found. Then the results
+ * are merged. The plan lists jobs in the order a single search meets them,
+ * so merging in that order, and keeping the first of each graph, gives the
+ * single search's list. With --list the parent hands out the jobs in plan
+ * order instead, through a pipe, and no more than 2K past the first whose
+ * results aren't printed yet, so no more than that many wait on disk. The
+ * workers report each job done through another pipe, and the parent sleeps
+ * on that one until the next results can be printed or a worker exits.
+ * The search itself is passed in: search(path, forms) fills forms with the
+ * distinct graphs below path, in the order found, or returns false. */
+struct Queue {
+    vector<Plan::Job> jobs;
+    const char *dir;
+    bool list;
+    int hexmin, hexmax;
+    vector<int>& counts;  // by nhex, of the graphs merged
+    std::set<std::string> all;
+    size_t released = 0;  // the jobs merged, in plan order
+    bool foreign = false;  // a result with a graph these options don't count
+    unsigned long nlisted = 0;
+
+    Queue(const char *d, bool l, int hmin, int hmax, vector<int>& c)
+        : dir(d), list(l), hexmin(hmin), hexmax(hmax), counts(c) {}
+
+    std::string jobfile(size_t j, const char *ext) const {
+        return std::string(dir) + "/job-" + std::to_string(j) + ext;
+    }
+
+    /* Job j, unless it has a result or (if not wait) someone else has it
+     * locked; false on an error */
+    template<class Search> bool runjob(size_t j, bool wait, Search& search) {
+        const std::string res = jobfile(j, ".res");
+        if (!access(res.c_str(), F_OK))
+            return true;
+        const int lock = open(jobfile(j, ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+        if (lock < 0) {
+            perror(dir);
+            return false;
+        }
+        if (flock(lock, wait ? LOCK_EX : LOCK_EX | LOCK_NB) || !access(res.c_str(), F_OK)) {
+            close(lock);
+            return true;
+        }
+        vector<std::string> forms;
+        if (!search(jobs[j].path, forms))
+            return false;
+        const std::string tmp = jobfile(j, ".tmp");
+        FILE *f = fopen(tmp.c_str(), "w");
+        if (!f) {
+            perror(tmp.c_str());
+            return false;
+        }
+        fprintf(f, "# job %zu: %s\n", j, pathText(jobs[j].path).c_str());
+        for (const std::string& form : forms)
+            fprintf(f, "%s\n", form.c_str());
+        if (!replacefile(f, tmp, res.c_str())) {
+            perror(res.c_str());
+            return false;
+        }
+        close(lock);
+        return true;
+    }
+
+    template<class Search> bool worker(Search& search) {
+        vector<size_t> order(jobs.size());
+        for (size_t j = 0; j < order.size(); ++j)
+            order[j] = j;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return jobs[a].cost > jobs[b].cost;
+        });
+        for (size_t j : order)
+            if (!runjob(j, false, search))
+                return false;
+        return true;
+    }
+
+    /* Merge the results there are, in plan order, up to the first job
+     * without one */
+    void release() {
+        char line[1 << 16];
+        for (FILE *f; !foreign && released < jobs.size()
+                      && (f = fopen(jobfile(released, ".res").c_str(), "r")); ++released) {
+            std::string form;
+            while (fgets(line, sizeof line, f)) {
+                form += line;
+                if (form.back() != '\n')
+                    continue;  // longer than the buffer
+                form.pop_back();
+                if (form[0] != '#' && all.insert(form).second) {
+                    const int nhex = atoi(form.c_str());
+                    if (nhex < hexmin || nhex > hexmax) {
+                        fprintf(stderr, "%s: not a result of this plan with these options\n",
+                                jobfile(released, ".res").c_str());
+                        foreign = true;
+                        break;
+                    }
+                    ++counts[nhex];
+                    if (list)
+                        printf("%6lu. %s\n", ++nlisted, form.c_str());
+                }
+                form.clear();
+            }
+            fclose(f);
+        }
+        fflush(stdout);
+    }
+
+    /* Run the jobs without results in nworkers processes, merging as they
+     * finish with --list; false if it couldn't start */
+    template<class Search> bool run(int nworkers, Search& search) {
+        mkdir(dir, 0755);
+        fflush(NULL);
+        int status, nfailed = 0;
+        if (!list) {
+            for (int w = 0; w < nworkers; ++w)
+                if (!fork())
+                    _exit(worker(search) ? 0 : 1);
+            while (waitpid(-1, &status, 0) > 0)
+                nfailed += !WIFEXITED(status) || WEXITSTATUS(status);
+        } else {
+            int todo[2], done[2];
+            if (pipe(todo) || pipe(done)) {
+                perror("pipe");
+                return false;
+            }
+            wakefd = done[1];
+            struct sigaction sa = {};
+            sa.sa_handler = onchild;
+            sa.sa_flags = SA_RESTART;
+            sigaction(SIGCHLD, &sa, NULL);
+            for (int w = 0; w < nworkers; ++w)
+                if (!fork()) {
+                    signal(SIGCHLD, SIG_DFL);
+                    close(todo[1]);
+                    close(done[0]);
+                    bool ok = true;
+                    for (uint32_t j; ok && read(todo[0], &j, sizeof j) == sizeof j; )
+                        ok = runjob(j, true, search) && write(done[1], &j, sizeof j) == sizeof j;
+                    _exit(ok ? 0 : 1);
+                }
+            close(todo[0]);
+            const size_t window = 2 * nworkers;
+            size_t handed = 0;
+            auto stophanding = [&]() {
+                if (todo[1] >= 0)
+                    close(todo[1]);
+                todo[1] = -1;
+            };
+            auto handout = [&]() {
+                for (; todo[1] >= 0 && handed < jobs.size()
+                       && handed < released + window; ++handed) {
+                    const uint32_t j = handed;
+                    if (write(todo[1], &j, sizeof j) != sizeof j)
+                        stophanding();
+                }
+                if (handed == jobs.size())
+                    stophanding();  // the workers finish up and exit
+            };
+            release();
+            handout();
+            int running = nworkers;
+            for (uint32_t j; running && read(done[0], &j, sizeof j) == sizeof j; ) {
+                if (j != WORKER_EXITED) {
+                    release();
+                    if (foreign)
+                        stophanding();
+                    else
+                        handout();
+                    continue;
+                }
+                for (pid_t pid; (pid = waitpid(-1, &status, WNOHANG)) > 0; --running)
+                    if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+                        ++nfailed;
+                        stophanding();  // its job won't come; let the rest stop
+                    }
+            }
+            signal(SIGCHLD, SIG_DFL);
+            stophanding();
+            close(done[0]);
+            close(done[1]);
+        }
+        if (nfailed)
+            fprintf(stderr, "%d workers failed; run again to finish\n", nfailed);
+        return true;
+    }
+};
+
+int main(int argc, char *argv[]) {
+    bool orderly = false, nauty = false, showstats = false, bfs = false, deepen = false;
+    int hexmin = 1, hexmax = -1;
+    const char *savepath = NULL, *extendpath = NULL, *ckptpath = NULL, *pathtext = NULL;
+    long nprobes = 0;
+    const char *planpath = NULL, *runplan = NULL, *queuedir = NULL;
+    int plandepth = 4, ngroups = 1, group = -1, nworkers = 1;
+    bool mergeonly = false, list = false;
+    uint64_t seed = std::chrono::steady_clock::now().time_since_epoch().count();
+    bool resume = false;
+    double ckptevery = 600;
+    long deadslots = 1 << 18;
+    double isomb = 0;
+    const char *endgamepath = NULL;
+    bool comparefaces = false, comparing = false, countonly = false, dual = false;
+    bool spiral = false, spiralmissed = false, missing = false;
+    int endgameopen = 4, endgamepaths = 64;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--orderly"))
+            orderly = true;
+        else if (!strcmp(argv[i], "--nauty"))
+            nauty = true;
+        else if (!strcmp(argv[i], "--stats"))
+            showstats = true;
+        else if (!strcmp(argv[i], "--bfs"))
+            bfs = true;
+        else if (!strcmp(argv[i], "--deepen"))
+            deepen = true;
+        else if (!strcmp(argv[i], "--hex-min") && i + 1 < argc)
+            hexmin = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hex-max") && i + 1 < argc)
+            hexmax = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--save-frontier") && i + 1 < argc)
+            savepath = argv[++i];
+        else if (!strcmp(argv[i], "--extend") && i + 1 < argc)
+            extendpath = argv[++i];
+        else if (!strcmp(argv[i], "--checkpoint") && i + 1 < argc)
+            ckptpath = argv[++i];
+        else if (!strcmp(argv[i], "--checkpoint-every") && i + 1 < argc)
+            ckptevery = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--resume"))
+            resume = true;
+        else if (!strcmp(argv[i], "--path") && i + 1 < argc)
+            pathtext = argv[++i];
+        else if (!strcmp(argv[i], "--estimate") && i + 1 < argc)
+            nprobes = atol(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--plan") && i + 1 < argc)
+            planpath = argv[++i];
+        else if (!strcmp(argv[i], "--plan-depth") && i + 1 < argc)
+            plandepth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--groups") && i + 1 < argc)
+            ngroups = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--run-plan") && i + 2 < argc) {
+            runplan = argv[++i];
+            group = atoi(argv[++i]);
+        }
+        else if ((!strcmp(argv[i], "--queue") || !strcmp(argv[i], "--merge")) && i + 2 < argc) {
+            mergeonly = !strcmp(argv[i], "--merge");
+            runplan = argv[++i];
+            queuedir = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--workers") && i + 1 < argc)
+            nworkers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--list"))
+            list = true;
+        else if (!strcmp(argv[i], "--symmetric"))
+            symmetric = true;
+        else if (!strcmp(argv[i], "--count-only"))
+            countonly = true;
+        else if (!strcmp(argv[i], "--dual"))
+            dual = true;
+        else if (!strcmp(argv[i], "--spiral"))
+            spiral = true;
+        else if (!strcmp(argv[i], "--spiral-missed"))
+            spiral = spiralmissed = true;
+        else if (!strcmp(argv[i], "--dead-ends") && i + 1 < argc)
+            deadslots = atol(argv[++i]);
+        else if (!strcmp(argv[i], "--iso-cache") && i + 1 < argc)
+            isomb = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--face") && i + 1 < argc) {
+            const char *name = argv[++i];
+            GraphState::facerule = std::find_if(faceRules, faceRules + GraphState::NUM_FACE_RULES,
+                [&](const char *r) { return !strcmp(r, name); }) - faceRules;
+        }
+        else if (!strcmp(argv[i], "--compare-faces"))
+            comparefaces = true;
+        else if (!strcmp(argv[i], "--endgame") && i + 1 < argc)
+            endgamepath = argv[++i];
+        else if (!strcmp(argv[i], "--endgame-open") && i + 1 < argc)
+            endgameopen = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--endgame-paths") && i + 1 < argc)
+            endgamepaths = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [--orderly | --nauty] [--bfs | --deepen] [--stats]"
+                    " [--hex-min N] [--hex-max N]\n"
+                    "       [--save-frontier FILE] [--extend FILE]"
+                    " [--checkpoint FILE [--checkpoint-every SECS] [--resume]]\n"
+                    "       [--path P] [--estimate PROBES [--seed S]]\n"
+                    "       [--plan FILE [--plan-depth D] [--groups N]] [--run-plan FILE G]\n"
+                    "       [--queue FILE DIR [--workers K]] [--merge FILE DIR] [--list]"
+                    " [--dead-ends SLOTS] [--iso-cache MB]\n"
+                    "       [--endgame FILE [--endgame-open K] [--endgame-paths M]]"
+                    " [--face RULE | --compare-faces] [--symmetric] [--count-only]\n"
+                    "       [--dual] [--spiral] [--spiral-missed]\n"
+                    "  --orderly  keep only canonically built graphs; no dedup store\n"
+                    "  --nauty    dedup by nauty canonical forms, not planar codes\n"
+                    "  --bfs      search level by level, printing each count when final\n"
+                    "  --deepen   search again for each number of hexagons, without end\n"
+                    "             unless --hex-max is given\n"
+                    "  --stats    report search statistics on stderr\n"
+                    "  --hex-min  don't canonicalise or count graphs with fewer hexagons\n"
+                    "  --hex-max  prune graphs with more hexagons (at most %d, bar --deepen)\n"
+                    "  --save-frontier  write what the face limit cut off, to extend later\n"
+                    "  --extend   go on from a saved frontier, up to the new hex-max\n"
+                    "  --checkpoint  save the search position every so often (600s)\n"
+                    "  --resume   carry on from the checkpoint\n"
+                    "  --path     search only below the state that path P leads to\n"
+                    "             (face.method steps from the seed, joined by commas)\n"
+                    "  --estimate  estimate the size and time of --orderly runs from\n"
+                    "             random probes, without searching\n"
+                    "  --plan     split the search at depth D (4) into jobs, estimate\n"
+                    "             each by PROBES (200) probes, and pack them into N groups\n"
+                    "  --run-plan  search the jobs of group G of a plan\n"
+                    "  --queue    run all of a plan's jobs in K processes, results in DIR;\n"
+                    "             run it again to finish after a crash\n"
+                    "  --merge    dedup the results in DIR and print the counts\n"
+                    "  --list     number and print each graph's canonical form as found;\n"
+                    "             --queue gives the same list as a single process\n"
+                    "  --dead-ends  slots in the table of boundaries that lead nowhere\n"
+                    "             (%d; 0 for none)\n"
+                    "  --iso-cache  skip patches isomorphic to one searched at the same\n"
+                    "             depth, keeping up to MB of them; not with --orderly\n"
+                    "  --endgame  look up the closures of boundaries of up to K (4) open\n"
+                    "             faces in FILE, recording those not there and any with\n"
+                    "             up to M (64) closures, and save it at the end\n"
+                    "  --face     which open face to close next: longest (the default),\n"
+                    "             fewest (valid methods) or squeezed (shortest neighbours)\n"
+                    "  --compare-faces  run with each --face rule in turn; report nodes\n"
+                    "             and time, and check the counts agree\n"
+                    "  --symmetric  only graphs with a mirror symmetry, pruning patches\n"
+                    "             that can't grow into one\n"
+                    "  --count-only  count by placements and symmetries, without\n"
+                    "             canonical forms or a dedup store; slower than the\n"
+                    "             others, for a cross-check only\n"
+                    "  --dual     build the dual triangulations instead, triangle by\n"
+                    "             triangle, as a check on the search\n"
+                    "  --spiral   wind up face spirals starting at the triangle instead\n"
+                    "  --spiral-missed  the spirals, then the search; list the graphs\n"
+                    "             the search finds and the spirals don't\n",
+                    argv[0], MAX_FACES - 8, 1 << 18);
+            return 1;
+        }
+    }
+    if (hexmax < 0 && !deepen)
+        hexmax = MAX_FACES - 8;
+    if ((bfs && deepen) || hexmin < 1 || (hexmax >= 0 && hexmin > hexmax)) {
+        fprintf(stderr, "Need 1 <= hex-min <= hex-max, and not both --bfs and --deepen\n");
+        return 1;
+    }
+    if (hexmax > MAX_FACES - 8 && !deepen) {
+        fprintf(stderr, "hex-max can be at most %d: rebuild with a larger MAX_FACES, "
+                "or use --deepen\n", MAX_FACES - 8);
+        return 1;
+    }
+    if ((savepath || extendpath) && (bfs || deepen)) {
+        fprintf(stderr, "--save-frontier and --extend go with the plain search only\n");
+        return 1;
+    }
+    if ((pathtext || runplan) && (bfs || deepen || extendpath)) {
+        fprintf(stderr, "--path and --run-plan go with the plain search only\n");
+        return 1;
+    }
+    if ((ckptpath || resume) && (bfs || deepen || savepath || extendpath || pathtext
+                                 || runplan || !ckptpath)) {
+        fprintf(stderr, "--checkpoint goes with the plain search only; --resume needs it\n");
+        return 1;
+    }
+    if (GraphState::facerule == GraphState::NUM_FACE_RULES) {
+        fprintf(stderr, "--face is one of longest, fewest, squeezed\n");
+        return 1;
+    }
+    if (comparefaces && (planpath || runplan || nprobes || ckptpath || savepath
+                         || extendpath || endgamepath)) {
+        fprintf(stderr, "--compare-faces goes with searches that write no files\n");
+        return 1;
+    }
+    if (isomb > 0 && (orderly || bfs || savepath)) {
+        fprintf(stderr, "--iso-cache goes with the dedup store, depth first, and not"
+                " --save-frontier\n");
+        return 1;
+    }
+    if (endgamepath && (bfs || deepen || savepath)) {
+        fprintf(stderr, "--endgame goes with a depth-first search to one face limit,"
+                " and not --save-frontier\n");
+        return 1;
+    }
+    if (symmetric && (savepath || extendpath || endgamepath)) {
+        fprintf(stderr, "--symmetric doesn't go with --save-frontier, --extend or --endgame\n");
+        return 1;
+    }
+    if (countonly && (orderly || bfs || deepen || savepath || extendpath || pathtext
+                      || runplan || ckptpath || list || isomb > 0 || symmetric)) {
+        fprintf(stderr, "--count-only goes with the plain search, without --list,"
+                " --iso-cache or --symmetric\n");
+        return 1;
+    }
+    if (dual && (orderly || bfs || deepen || savepath || extendpath || pathtext || runplan
+                 || ckptpath || nprobes || planpath || countonly || isomb > 0 || endgamepath
+                 || comparefaces)) {
+        fprintf(stderr, "--dual goes with the plain search only, and the dedup store\n");
+        return 1;
+    }
+    if (spiral && (dual || orderly || bfs || deepen || savepath || extendpath || pathtext
+                   || runplan || ckptpath || nprobes || planpath || countonly || isomb > 0
+                   || endgamepath || comparefaces || symmetric)) {
+        fprintf(stderr, "--spiral goes with the plain search only, and the dedup store\n");
+        return 1;
+    }
+    maxFaces = hexmax + 8;
+    int minFaces = hexmin + 8;  // smaller graphs aren't canonicalised or counted
+
+    if (comparefaces) {
+        /* Each rule in turn in a child, which goes on from here as if given
+         * --face, with its output piped back and its node count after */
+        vector<std::string> outs;
+        bool same = true;
+        printf("rule         nodes  seconds  counts\n");
+        fflush(stdout);
+        for (int r = 0; r < GraphState::NUM_FACE_RULES; ++r) {
+            int fd[2];
+            if (pipe(fd)) {
+                perror("pipe");
+                return 1;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            const pid_t pid = fork();
+            if (!pid) {
+                close(fd[0]);
+                dup2(fd[1], 1);
+                close(fd[1]);
+                GraphState::facerule = r;
+                comparing = true;
+                break;
+            }
+            close(fd[1]);
+            std::string out;
+            char buf[4096];
+            for (ssize_t k; (k = read(fd[0], buf, sizeof buf)) > 0; )
+                out.append(buf, k);
+            close(fd[0]);
+            int status;
+            const bool exited = pid > 0 && waitpid(pid, &status, 0) == pid
+                                && WIFEXITED(status) && !WEXITSTATUS(status);
+            const double secs = std::chrono::duration<double>(
+                                    std::chrono::steady_clock::now() - start).count();
+            const size_t last = out.rfind("nodes ");
+            const bool ok = exited && last != std::string::npos;
+            const unsigned long nodes = ok ? strtoul(out.c_str() + last + 6, NULL, 10) : 0;
+            if (ok)
+                out.erase(last);
+            outs.push_back(out);
+            same = same && ok && out == outs[0];
+            printf("%-9s %9lu %8.2f  %s\n", faceRules[r], nodes, secs,
+                   !ok ? "failed" : out == outs[0] ? "same" : "DIFFER");
+            fflush(stdout);
+        }
+        if (!comparing)
+            return same ? 0 : 1;
+    }
+
+    if (planpath) {
+        if (deepen || ngroups < 1 || plandepth < 0) {
+            fprintf(stderr, "--plan needs a face limit, --groups >= 1 and --plan-depth >= 0\n");
+            return 1;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        Plan plan(plandepth, ngroups, nprobes > 0 ? nprobes : 200, seed);
+        if (!plan.write(planpath, plandepth)) {
+            perror(planpath);
+            return 1;
+        }
+        const auto mm = std::minmax_element(plan.load.begin(), plan.load.end());
+        fprintf(stderr, "%zu jobs in %d groups of %.3g to %.3g s (estimated), in %.2fs\n",
+                plan.jobs.size(), ngroups, *mm.first, *mm.second,
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        return 0;
+    }
+    if (nprobes > 0) {
+        if (deepen) {
+            fprintf(stderr, "--estimate needs a face limit\n");
+            return 1;
+        }
+        Estimator est(maxFaces, seed);
+        const auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < nprobes; ++i)
+            est.probe();
+        fprintf(stderr, "%ld probes in %.2fs (seed %llu); 95%% intervals\n", nprobes,
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+                (unsigned long long)seed);
+        printf("hex  graphs with that many hexagons;  a run up to there: nodes, seconds\n");
+        for (int i = hexmin; i <= hexmax; ++i) {
+            const auto g = est.mean(Estimator::GRAPHS, i),
+                       n = est.mean(Estimator::NODES, i + 8),
+                       t = est.mean(Estimator::SECS, i + 8);
+            printf("%d:  %.4g +- %.2g;  %.4g +- %.2g,  %.3g +- %.2g\n", i, g.first, g.second,
+                   n.first, n.second, t.first, t.second);
+        }
+        return 0;
+    }
+
+    SolutionStore canonslns(nauty);
+    vector<int> nsuccess(std::max(MAX_FACES, maxFaces) - 6); // allow for 'overslop' of 1 face
+    /* --count-only: 60 / CanonPath::reached() for each closure, by nhex, to
+     * keep it whole */
+    vector<uint64_t> nrooted(nsuccess.size());
+    unsigned long nnodes = 0, npruned[NUM_PRUNE] = {};
+    unsigned long nforced = 0, nstuck = 0;  // by the depth-first searches
+    FrontierWriter *frontier = NULL;
+    if (savepath) {
+        frontier = new FrontierWriter(savepath, maxFaces);
+        if (!frontier->f) {
+            perror(savepath);
+            return 1;
+        }
+    }
+
+    /* Only for depth-first searches, which see each subtree end; and not
+     * with --save-frontier, as a subtree with nothing in it can still have
+     * something for the frontier; nor --symmetric, whose pruning looks at
+     * more than the boundary. */
+    DeadEnds *deadends = deadslots > 0 && !bfs && !savepath && !symmetric && !dual
+                         && (!spiral || spiralmissed) ? new DeadEnds(deadslots) : NULL;
+    /* Closures that get past the sizes and limits, and subtrees skipped as
+     * isomorphic to one searched, which may have had some */
+    unsigned long nviable = 0;
+    IsoCache *isocache = isomb > 0 ? new IsoCache(isomb * (1 << 20)) : NULL;
+    Endgame *endgame = NULL;
+    if (endgamepath) {
+        endgame = new Endgame(endgameopen, endgamepaths, minFaces);
+        if (!endgame->load(endgamepath)) {
+            fprintf(stderr, "%s: not an endgame table for these limits\n", endgamepath);
+            return 1;
+        }
+    }
+
+    vector<std::string> *jobforms = NULL;  // a --queue job's graphs, in order found
+    std::set<std::string> jobseen;
+    unsigned long nlisted = 0;
+
+    auto closed = [&](const GraphState& G) {
+        if (frontier && G.faces.size() > (uint)maxFaces && G.sizefinal())
+            frontier->add(G, 0);
+        if (G.sizefinal() && G.faces.size() <= (uint)maxFaces
+                          && G.faces.size() >= (uint)minFaces
+                          && (!symmetric || mirrored(G))) {
+            ++nviable;
+            if (countonly) {
+                nrooted[G.nhex] += 60 / CanonPath(G).reached();
+            } else if (jobforms) {
+                if (!orderly || CanonPath(G).canonical()) {
+                    std::string form = canonstring(G);
+                    if (jobseen.insert(form).second)
+                        jobforms->push_back(std::move(form));
+                }
+            } else if (orderly ? CanonPath(G).canonical() : canonslns.insert(G)) {
+                ++nsuccess[G.nhex];
+                if (list)
+                    printf("%6lu. %s\n", ++nlisted, canonstring(G).c_str());
+                if (missing)
+                    printf("missed %s\n", canonstring(G).c_str());
+            }
+            /* To write graph6 output, #include "gtools.h" and:
+                writeg6_sg(stdout, &G.canong);
+             */
+        }
+    };
+
+    /* Checkpoints, for long runs. The path to the current state, and the
+     * move it is on, pin down the search position; with them go
+     * the counts, the number of graphs --list has printed (which are flushed
+     * first) and the dedup store. Each is written to FILE.tmp and renamed over FILE, so a
+     * crash mid-write, or a reboot, leaves the last one whole. Writing can take a while
+     * with a big store, so the interval is stretched to at least 100 times
+     * the last write. */
+    const char ckptMagic[8] = {'P','L','C','H','E','C','K','2'};
+    auto ckptwrite = [&](const Path& path, const GraphState& G) {
+        if (list)
+            fflush(stdout);
+        const std::string tmp = std::string(ckptpath) + ".tmp";
+        FILE *f = fopen(tmp.c_str(), "wb");
+        if (!f) {
+            perror(tmp.c_str());
+            exit(1);
+        }
+        fwrite(ckptMagic, 1, sizeof ckptMagic, f);
+        put(f, vector<int32_t>{ maxFaces, minFaces, orderly, nauty, GraphState::facerule,
+                              symmetric });
+        put(f, vector<uint64_t>(npruned, npruned + NUM_PRUNE));
+        put(f, (uint64_t)nnodes);
+        put(f, (uint64_t)nlisted);
+        put(f, vector<int32_t>(nsuccess.begin(), nsuccess.end()));
+        Path at = path;
+        at.push_back({ (uint8_t)G.chosenFace, (uint8_t)G.medgadd });
+        put(f, at);
+        canonslns.save(f);
+        if (!replacefile(f, tmp, ckptpath)) {
+            perror(ckptpath);
+            exit(1);
+        }
+    };
+    auto ckptread = [&](deque<GraphState>& graphStack, GraphState& G) {
+        FILE *f = fopen(ckptpath, "rb");
+        if (!f) {
+            perror(ckptpath);
+            exit(1);
+        }
+        char magic[sizeof ckptMagic];
+        vector<int32_t> params, counts;
+        vector<uint64_t> pruned;
+        Path path;
+        uint64_t nodes, listed;
+        bool ok = fread(magic, 1, sizeof magic, f) == sizeof magic
+                    && !memcmp(magic, ckptMagic, sizeof magic)
+                    && get(f, params) && get(f, pruned) && get(f, nodes) && get(f, listed)
+                    && get(f, counts) && get(f, path) && canonslns.load(f);
+        fclose(f);
+        if (!ok || pruned.size() != NUM_PRUNE || counts.size() != nsuccess.size()
+                || path.empty()) {
+            fprintf(stderr, "%s: not a checkpoint from this build\n", ckptpath);
+            exit(1);
+        }
+        if (params != vector<int32_t>{ maxFaces, minFaces, orderly, nauty, GraphState::facerule,
+                              symmetric }) {
+            fprintf(stderr, "%s: checkpoint is for other options\n", ckptpath);
+            exit(1);
+        }
+        std::copy(pruned.begin(), pruned.end(), npruned);
+        nnodes = nodes;
+        nlisted = listed;
+        nsuccess.assign(counts.begin(), counts.end());
+        const Move at = path.back();
+        path.pop_back();
+        if (!replay(path, G, &graphStack)) {
+            fprintf(stderr, "%s: bad search path\n", ckptpath);
+            exit(1);
+        }
+        G.chosenFace = at.face;
+        G.medgadd = at.meth;
+    };
+
+    if (bfs) {
+        /* Level by level: a state waits in frontier[k], where k is the fewest
+         * faces any of its closures can have (faces.size() + morefaces(), and
+         * no less than its parent's). So once level k is empty, every graph
+         * with k faces has been found: its count is final and printed, and
+         * its dedup level is freed. Within a level the search is depth-first,
+         * so only the later levels pile up, packed. */
+        struct Pending {
+            PackedState P;
+            size_t depth;
+        };
+        vector<vector<Pending>> frontier(maxFaces + 1);
+        GraphState seed{};
+        frontier[std::max(0, (int)seed.faces.size() + seed.morefaces())].push_back({PackedState(seed), 0});
+        for (int k = 0; k <= maxFaces; ++k) {
+            vector<Pending>& level = frontier[k];
+            while (!level.empty()) {
+                GraphState S = level.back().P.unpack();
+                const size_t depth = level.back().depth + 1;
+                level.pop_back();
+                while (S.incMethod()) {
+                    GraphState C = S;
+                    C.addEdges();
+                    ++nnodes;
+                    if (C.openfaces.empty()) {
+                        closed(C);
+                        continue;
+                    }
+                    if (const int why = prune(C, depth)) {
+                        ++npruned[why];
+                        continue;
+                    }
+                    C.chooseFace();
+                    const int ck = std::max(k, (int)C.faces.size() + C.morefaces());
+                    frontier[ck].push_back({PackedState(C), depth});
+                }
+            }
+            vector<Pending>().swap(level);
+            if (k >= 8 + hexmin) {
+                printf("%d:  %d\n", k - 8, nsuccess[k - 8]);
+                fflush(stdout);
+                canonslns.release(k - 8);
+            }
+        }
+    } else {
+        /* If the endgame table knows G's boundary, play out its closures and
+         * say so. path leads to G from the start of the search. */
+        auto endgameat = [&](const GraphState& G, const Path& path) {
+            const vector<Path> *known = endgame->lookup(G);
+            if (!known)
+                return false;
+            for (const Path& q : *known) {
+                GraphState C = G;
+                for (const Move& m : q) {
+                    C.chosenFace = m.face;
+                    C.medgadd = m.meth;
+                    C.addEdges();
+                }
+                closed(C);
+                ++endgame->nreplayed;
+                if (!endgame->pending.empty()) {
+                    Path p = path;
+                    p.insert(p.end(), q.begin(), q.end());
+                    endgame->found(p);
+                }
+            }
+            return true;
+        };
+
+        /* Depth-first from G, which is depth0 steps from the seed (or from
+         * the seed, through graphStack). Where the chosen face can be closed
+         * only one way, that move is made on the spot, with no backtrack
+         * point; so the stack holds only states with a choice, and path
+         * holds every move from the start. */
+        auto search = [&](GraphState G, size_t depth0, deque<GraphState> graphStack) {
+            auto lastckpt = std::chrono::steady_clock::now();
+            uint sinceckpt = 0;
+            /* nviable when each state on the stack, and G, was started; a
+             * state that ends with it unchanged is a dead end. States resumed
+             * from a checkpoint may have found things before, so never are. */
+            const unsigned long unknown = -1;
+            vector<unsigned long> started(graphStack.size(), unknown);
+            unsigned long gstarted = graphStack.empty() ? nviable : unknown;
+            Path path = stackPath(graphStack);
+            vector<size_t> at(graphStack.size());  // path.size() at each on the stack
+            for (size_t i = 0; i < at.size(); ++i)
+                at[i] = i;
+            /* The forced states on the path, to enter as dead ends when the
+             * path is cut back past them, if nothing was found meanwhile.
+             * Their endgame records are finished then too. */
+            struct Forced {
+                size_t at;
+                DeadEnds::Key key;
+                unsigned long started;
+            };
+            vector<Forced> forced;
+            auto cutback = [&](size_t to) {
+                for (; !forced.empty() && forced.back().at >= to; forced.pop_back())
+                    if (forced.back().started == nviable)
+                        deadends->add(forced.back().key);
+                if (endgame)
+                    endgame->finish(to + 1);  // the state at to has more to try
+            };
+            if (deadends)
+                deadends->limits(maxFaces, minFaces);
+            if (endgame && graphStack.empty())
+                endgame->start(G, 0);
+
+            bool pop = false, fresh = false;
+            for(;;) {
+                if (pop) {
+                    cutback(graphStack.empty() ? 0 : at.back());
+                    if (graphStack.empty())
+                        break;
+                    G = graphStack.back();
+                    graphStack.pop_back();
+                    gstarted = started.back();
+                    started.pop_back();
+                    path.resize(at.back());
+                    at.pop_back();
+                    pop = false;
+                }
+                if (!fresh) {
+                    if (ckptpath && ++sinceckpt == 4096) {
+                        sinceckpt = 0;
+                        const auto now = std::chrono::steady_clock::now();
+                        if (std::chrono::duration<double>(now - lastckpt).count() >= ckptevery) {
+                            ckptwrite(path, G);
+                            lastckpt = std::chrono::steady_clock::now();
+                            ckptevery = std::max(ckptevery, 100 *
+                                std::chrono::duration<double>(lastckpt - now).count());
+                        }
+                    }
+                    if (!G.incMethod()) {
+                        if (deadends && gstarted == nviable)
+                            deadends->add(G, depth0 + path.size());
+                        if (endgame)
+                            endgame->finish(path.size());
+                        pop = true;
+                        continue;
+                    }
+                    graphStack.push_back(G);
+                    started.push_back(gstarted);
+                    at.push_back(path.size());
+                    path.push_back({ (uint8_t)G.chosenFace, (uint8_t)G.medgadd });
+                    G.addEdges();
+                    ++nnodes;
+                }
+                fresh = false;
+                const size_t depth = depth0 + path.size();
+
+                if (G.openfaces.empty()) {
+                    closed(G);
+                    if (endgame && !endgame->pending.empty() && G.sizefinal()
+                            && G.faces.size() <= (uint)maxFaces
+                            && G.faces.size() >= (uint)minFaces)
+                        endgame->found(path);
+                    pop = true;
+                    continue;
+                }
+
+                if (const int why = prune(G, depth)) {
+                    ++npruned[why];
+                    if (frontier && cutoff(why))
+                        frontier->add(G, depth);
+                    pop = true;
+                    continue;
+                }
+                if (deadends && deadends->dead(G, depth)) {
+                    pop = true;
+                    continue;
+                }
+                if (isocache && isocache->seen(G, depth)) {
+                    ++nviable;
+                    if (endgame)
+                        endgame->spoil();
+                    pop = true;
+                    continue;
+                }
+                if (endgame && endgameat(G, path)) {
+                    pop = true;
+                    continue;
+                }
+
+                G.chooseFace();
+                if (const int only = G.forcedMethod()) {
+                    if (only > 0) {
+                        DeadEnds::Key k;
+                        if (deadends && DeadEnds::key(G, depth, k))
+                            forced.push_back({ path.size(), k, nviable });
+                        if (endgame)
+                            endgame->start(G, path.size());
+                        G.medgadd = only;
+                        path.push_back({ (uint8_t)G.chosenFace, (uint8_t)only });
+                        G.addEdges();
+                        ++nnodes;
+                        ++nforced;
+                        fresh = true;
+                        continue;
+                    }
+                } else {
+                    ++nstuck;  // the chosen face can't be closed
+                    pop = true;
+                    continue;
+                }
+                if (endgame)
+                    endgame->start(G, path.size());
+                gstarted = nviable;
+            }
+        };
+
+        /* The search below G, fresh from addEdges() after depth steps */
+        auto searchbelow = [&](GraphState& G, size_t depth) {
+            if (G.openfaces.empty()) {
+                closed(G);
+                return;
+            }
+            if (const int why = prune(G, depth)) {
+                ++npruned[why];
+                if (frontier && cutoff(why))
+                    frontier->add(G, depth);
+                return;
+            }
+            if (deadends && deadends->dead(G, depth))
+                return;
+            if (isocache && isocache->seen(G, depth)) {
+                ++nviable;
+                if (endgame)
+                    endgame->spoil();
+                return;
+            }
+            if (endgame && endgameat(G, {}))
+                return;
+            G.chooseFace();
+            search(G, depth, {});
+        };
+
+        if (deepen) {
+            /* Iterative deepening: search again with a budget of one more face
+             * each round, counting only graphs that use all of it. The search
+             * below any budget is finite, so this never loops, and it needs
+             * no more than the DFS stack and one size of dedup store. */
+            for (int F = minFaces; hexmax < 0 || F <= hexmax + 8; ++F) {
+                maxFaces = minFaces = F;
+                if (nsuccess.size() <= (uint)F - 8)
+                    nsuccess.resize(F - 7);
+                const unsigned long before = nnodes;
+                search(GraphState{}, 0, {});
+                printf("%d:  %d\n", F - 8, nsuccess[F - 8]);
+                fflush(stdout);
+                if (showstats)
+                    fprintf(stderr, "%d faces: %lu nodes\n", F, nnodes - before);
+                canonslns.release(F - 8);
+            }
+        } else if (extendpath) {
+            FrontierReader in(extendpath);
+            if (!in.f || !in.maxFaces) {
+                fprintf(stderr, "%s: not a frontier file\n", extendpath);
+                return 1;
+            }
+            if (in.rule != GraphState::facerule) {
+                fprintf(stderr, "%s was saved with --face %s\n", extendpath, faceRules[in.rule]);
+                return 1;
+            }
+            if (in.maxFaces >= maxFaces) {
+                fprintf(stderr, "%s already goes up to %d hexagons\n", extendpath,
+                        in.maxFaces - 8);
+                return 1;
+            }
+            for (uint i = 0; i < in.counts.size(); ++i)
+                nsuccess[i] += in.counts[i];
+            GraphState G;
+            size_t depth;
+            uint64_t nread = 0;
+            while (in.next(G, depth)) {
+                ++nread;
+                searchbelow(G, depth);
+            }
+            if (nread != in.nstates) {
+                fprintf(stderr, "%s: truncated after %lu of %lu states\n", extendpath,
+                        (unsigned long)nread, (unsigned long)in.nstates);
+                return 1;
+            }
+            for (int i = hexmin; i <= hexmax; ++i)
+                printf("%d:  %d\n", i, nsuccess[i]);
+        } else if (queuedir) {
+            Queue queue(queuedir, list, hexmin, hexmax, nsuccess);
+            if (!Plan::read(runplan, queue.jobs)) {
+                fprintf(stderr, "%s: can't read the plan\n", runplan);
+                return 1;
+            }
+            auto searchjob = [&](const Path& path, vector<std::string>& forms) {
+                jobforms = &forms;
+                jobseen.clear();
+                if (isocache)
+                    isocache->clear();  // a job's results stand alone
+                GraphState G;
+                if (!replay(path, G)) {
+                    fprintf(stderr, "%s: not a search path\n", pathText(path).c_str());
+                    return false;
+                }
+                searchbelow(G, path.size());
+                return true;
+            };
+            if (!mergeonly) {
+                if (nworkers < 1) {
+                    fprintf(stderr, "--workers must be at least 1\n");
+                    return 1;
+                }
+                if (!queue.run(nworkers, searchjob))
+                    return 1;
+            }
+            queue.release();
+            if (queue.foreign)
+                return 1;
+            if (queue.released < queue.jobs.size()) {
+                fprintf(stderr, "Merged %zu of %zu jobs: job %zu has no result yet\n",
+                        queue.released, queue.jobs.size(), queue.released);
+                return 1;
+            }
+            for (int i = hexmin; i <= hexmax; ++i)
+                printf("%d:  %d\n", i, nsuccess[i]);
+        } else if (runplan) {
+            vector<Plan::Job> jobs;
+            if (!Plan::read(runplan, jobs)) {
+                fprintf(stderr, "%s: can't read the plan\n", runplan);
+                return 1;
+            }
+            vector<Path> paths;
+            for (const Plan::Job& j : jobs)
+                if (j.group == group)
+                    paths.push_back(j.path);
+            if (!orderly)
+                fprintf(stderr, "Without --orderly, the counts of groups don't add up\n");
+            const auto start = std::chrono::steady_clock::now();
+            for (const Path& p : paths) {
+                GraphState G;
+                if (!replay(p, G)) {
+                    fprintf(stderr, "%s: not a search path\n", pathText(p).c_str());
+                    return 1;
+                }
+                searchbelow(G, p.size());
+            }
+            if (showstats)
+                fprintf(stderr, "group %d: %zu jobs, %.2fs\n", group, paths.size(),
+                        std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start).count());
+            for (int i = hexmin; i <= hexmax; ++i)
+                printf("%d:  %d\n", i, nsuccess[i]);
+        } else if (pathtext) {
+            /* Just the subtree at the end of a path: for a job, or to look
+             * into one slow part of the search */
+            Path p;
+            GraphState G;
+            if (!parsePath(pathtext, p) || !replay(p, G)) {
+                fprintf(stderr, "%s: not a search path\n", pathtext);
+                return 1;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            searchbelow(G, p.size());
+            if (showstats)
+                fprintf(stderr, "below [%s]: %.2fs\n", pathText(p).c_str(),
+                        std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start).count());
+            for (int i = hexmin; i <= hexmax; ++i)
+                printf("%d:  %d\n", i, nsuccess[i]);
+        } else if (dual) {
+            vector<Triangulation> stack(1);
+            while (!stack.empty()) {
+                Triangulation T = std::move(stack.back());
+                stack.pop_back();
+                ++nnodes;
+                if (T.holes.empty())
+                    closed(T.dual());
+                else
+                    T.grow(stack, maxFaces);
+            }
+            for (int i = hexmin; i <= hexmax; ++i)
+                printf("%d:  %d\n", i, nsuccess[i]);
+        } else if (spiral) {
+            vector<Spiral> stack(1);
+            while (!stack.empty()) {
+                Spiral S = std::move(stack.back());
+                stack.pop_back();
+                ++nnodes;
+                if (S.shut)
+                    closed(S.dual());
+                else
+                    S.grow(stack, maxFaces);
+            }
+            if (spiralmissed) {
+                /* The store has the spirals' graphs, so whatever the search
+                 * adds to it they missed */
+                const vector<int> wound(nsuccess);
+                missing = true;
+                search(GraphState{}, 0, {});
+                missing = false;
+                for (int i = hexmin; i <= hexmax; ++i)
+                    printf("%d:  %d, %d missed\n", i, nsuccess[i], nsuccess[i] - wound[i]);
+            } else {
+                for (int i = hexmin; i <= hexmax; ++i)
+                    printf("%d:  %d\n", i, nsuccess[i]);
+            }
+        } else if (countonly) {
+            /* Burnside, more or less: each graph is closed once per orbit of
+             * the placements reaching it under its automorphisms, so weighing
+             * closures by 1 / reached() counts it 1 / |Aut| times. The automorphism
+             * is a reflection if anything (see mirrored()), so a second
+             * search for the symmetric graphs alone makes up the other
+             * halves. Neither needs a canonical form. The dead-end table
+             * and endgame hold for the first search only. */
+            search(GraphState{}, 0, {});
+            vector<uint64_t> asym(nrooted);
+            std::fill(nrooted.begin(), nrooted.end(), 0);
+            DeadEnds *const saveddead = deadends;
+            Endgame *const savedend = endgame;
+            deadends = NULL;
+            endgame = NULL;
+            symmetric = true;
+            search(GraphState{}, 0, {});
+            symmetric = false;
+            deadends = saveddead;
+            endgame = savedend;
+            for (int i = hexmin; i <= hexmax; ++i) {
+                const uint64_t sum = asym[i] + nrooted[i];
+                if (sum % 60 || nrooted[i] % 30) {
+                    fprintf(stderr, "%d hexagons: the weights don't add up (%lu, %lu)\n", i,
+                            (unsigned long)asym[i], (unsigned long)nrooted[i]);
+                    return 1;
+                }
+                nsuccess[i] = sum / 60;
+                printf("%d:  %d\n", i, nsuccess[i]);
+                if (showstats)
+                    fprintf(stderr, "%d hexagons: %lu symmetric\n", i,
+                            (unsigned long)(nrooted[i] / 30));
+            }
+        } else {
+            deque<GraphState> graphStack;
+            GraphState G{};
+            if (resume)
+                ckptread(graphStack, G);
+            search(G, 0, graphStack);
+            for (int i = hexmin; i <= hexmax; ++i)
+                printf("%d:  %d\n", i, nsuccess[i]);
+        }
+    }
+    if (frontier) {
+        const uint64_t nsaved = frontier->nstates;
+        if (!frontier->finish(nsuccess)) {
+            perror(savepath);
+            return 1;
+        }
+        if (showstats)
+            fprintf(stderr, "%lu frontier states saved\n", (unsigned long)nsaved);
+        delete frontier;
+    }
+    if (showstats) {
+        fprintf(stderr, "%lu nodes; pruned:", nnodes);
+        for (int i = 1; i < NUM_PRUNE; ++i)
+            fprintf(stderr, "%s %lu %s (%.1f%%)", i > 1 ? "," : "", npruned[i],
+                    pruneReasons[i], 100.0 * npruned[i] / nnodes);
+        fprintf(stderr, "\n");
+    }
+    if (showstats && !bfs && !dual && !(spiral && !spiralmissed))
+        fprintf(stderr, "forced: %lu nodes by the only valid method (%.1f%%), %lu states"
+                " with none\n", nforced, 100.0 * nforced / std::max(nnodes, 1ul), nstuck);
+    if (showstats && deadends)
+        fprintf(stderr, "dead ends: %lu lookups, %lu hits (%.1f%%); %lu stored, %lu replaced,"
+                " in %zu slots\n", deadends->nlookups, deadends->nhits,
+                100.0 * deadends->nhits / std::max(deadends->nlookups, 1ul),
+                deadends->nstored, deadends->nreplaced, deadends->slots.size());
+    if (showstats && isocache)
+        fprintf(stderr, "iso cache: %lu lookups, %lu hits (%.1f%%); %lu stored, %lu flushes\n",
+                isocache->nlookups, isocache->nhits,
+                100.0 * isocache->nhits / std::max(isocache->nlookups, 1ul),
+                isocache->nstored, isocache->nflushes);
+    if (comparing)
+        printf("nodes %lu\n", nnodes);
+    if (endgame && !queuedir && !endgame->save(endgamepath)) {
+        perror(endgamepath);
+        return 1;
     }
-    for (int i = 1; i < MAX_FACES-7; ++i)
-        printf("%d:  %d\n", i, nsuccess[i]);
+    if (showstats && endgame)
+        fprintf(stderr, "endgame: %lu lookups, %lu hits (%.1f%%), %lu closures replayed;"
+                " %lu recorded, %lu too big, %zu in the table\n", endgame->nlookups,
+                endgame->nhits, 100.0 * endgame->nhits / std::max(endgame->nlookups, 1ul),
+                endgame->nreplayed, endgame->nrecorded, endgame->ndropped,
+                endgame->table.size());
+    if (showstats && !orderly && !countonly)
+        fprintf(stderr, "%lu closed graphs, %zu distinct in %zu buckets; "
+                "%lu code comparisons, %lu nauty calls (%lu on trial)\n",
+                canonslns.ngraphs, canonslns.size(), canonslns.nbuckets(),
+                canonslns.ncompared, canonslns.nnauty, canonslns.ntrial);
     return 0;
 }